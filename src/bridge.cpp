@@ -1,12 +1,18 @@
 #include "bridge.h"
-#include <sys/epoll.h>
 #include <unistd.h>
 #include <cstring>
 #include <arpa/inet.h>
+#include <algorithm>
+#include <poll.h>
+
+// io_uring user_data tags for completions that do not belong to a buffer
+static const uint64_t URING_TAG_WAKEUP = ~0ULL;
+static const uint64_t URING_TAG_POLL = ~0ULL - 1;
 
 Bridge::Bridge(TunManager* tun, SocketManager* socket, CryptoManager* crypto)
-    : tun_manager(tun), socket_manager(socket), crypto_manager(crypto),
-      is_authenticated(false), should_stop(false), auth_in_progress(false), packets_processed(0), bytes_transferred(0),
+    : tun_manager(tun), socket_manager(socket), crypto_manager(crypto), io_engine(IoEngine::EPOLL), crypto_workers(0), spin_usec(0),
+      is_authenticated(false), should_stop(false), auth_in_progress(false), tx_gso(false), rx_gso(false),
+      packets_processed(0), bytes_transferred(0),
       last_stats_time(std::chrono::high_resolution_clock::now()),
       total_packets_sent(0), total_packets_received(0), total_bytes_sent(0), 
       total_bytes_received(0), dropped_packets(0), auth_failures(0) {
@@ -30,14 +36,84 @@ bool Bridge::start() {
     
     Logger::log(LogLevel::INFO, "Starting Bridge with multi-threading...");
     
+    if (io_engine == IoEngine::IO_URING && !UringEngine::is_supported()) {
+        Logger::log(LogLevel::WARNING, "io_uring not available, falling back to epoll");
+        io_engine = IoEngine::EPOLL;
+    }
+    
+    // Every peer can segment super-packets; only offload mode produces them.
+    // A datagram carries one MTU-sized frame, so UDP never passes them through.
+    if (crypto_manager && !socket_manager->is_datagram()) {
+        crypto_manager->set_local_capabilities(AUTH_CAP_GSO_RX |
+                                               (tun_manager->has_vnet_hdr() ? AUTH_CAP_GSO_TX : 0));
+    }
+    
+    // Pinned threads should find their packet buffers on their own node
+    if (!placement.empty()) {
+        int node = placement.numa_node();
+        if (node >= 0 && packet_pool.bind_to_node(node)) {
+            Logger::log(LogLevel::INFO, "Packet buffers bound to NUMA node " + std::to_string(node));
+        } else if (node < 0) {
+            Logger::log(LogLevel::INFO, "Pinned CPUs span NUMA nodes, packet buffers not bound");
+        }
+    }
+    
     try {
+        // One reader and an encrypt/decrypt pipeline pair per TUN queue
+        size_t queue_count = std::max<size_t>(tun_manager->get_queue_count(), 1);
+        workers.clear();
+        for (size_t i = 0; i < queue_count; i++) {
+            workers.push_back(std::make_unique<TunWorker>(i));
+        }
+        
+        // Optional crypto workers per pipeline. TUN packets can be steered by
+        // flow (hashed by the TUN reader); socket packets are still encrypted,
+        // so they are spread round robin and put back in order.
+        if (crypto_manager && crypto_workers > 0) {
+            for (auto& worker : workers) {
+                size_t queue = worker->queue_index;
+                worker->encrypt_pool = std::make_unique<CryptoPool>(crypto_workers, [this, queue](CryptoJob* jobs, size_t count) {
+                    wrap_jobs(jobs, count, queue);
+                }, worker->encrypt_waiter, flow_hasher.is_enabled(), [this, queue](size_t index) {
+                    placement.apply(ThreadRole::CRYPTO, 2 * queue * crypto_workers + index,
+                                    "ln-enc" + std::to_string(queue) + "-c" + std::to_string(index));
+                });
+                worker->decrypt_pool = std::make_unique<CryptoPool>(crypto_workers, [this](CryptoJob* jobs, size_t count) {
+                    unwrap_jobs(jobs, count);
+                }, worker->decrypt_waiter, false, [this, queue](size_t index) {
+                    placement.apply(ThreadRole::CRYPTO, (2 * queue + 1) * crypto_workers + index,
+                                    "ln-dec" + std::to_string(queue) + "-c" + std::to_string(index));
+                });
+            }
+        }
+        
+        // Latency mode: every data path thread spins a while before sleeping
+        if (spin_usec > 0) {
+            for (auto& worker : workers) {
+                worker->loop.set_busy_poll(spin_usec);
+                worker->encrypt_waiter.set_spin_usec(spin_usec);
+                worker->decrypt_waiter.set_spin_usec(spin_usec);
+                if (worker->encrypt_pool) {
+                    worker->encrypt_pool->set_spin_usec(spin_usec);
+                    worker->decrypt_pool->set_spin_usec(spin_usec);
+                }
+            }
+            socket_loop.set_busy_poll(spin_usec);
+            Logger::log(LogLevel::INFO, "Latency mode: busy-polling " + std::to_string(spin_usec) + " us before blocking");
+        }
+        
         // Start all threads
-        tun_reader_thread = std::thread(&Bridge::tun_reader_loop, this);
+        for (auto& worker : workers) {
+            worker->reader_thread = std::thread(&Bridge::tun_reader_loop, this, worker.get());
+            worker->encrypt_thread = std::thread(&Bridge::encrypt_loop, this, worker.get());
+            worker->decrypt_thread = std::thread(&Bridge::decrypt_loop, this, worker.get());
+        }
         socket_reader_thread = std::thread(&Bridge::socket_reader_loop, this);
-        packet_processor_thread = std::thread(&Bridge::packet_processor_loop, this);
         heartbeat_thread = std::thread(&Bridge::heartbeat_loop, this);
         
-        Logger::log(LogLevel::INFO, "All threads started successfully");
+        Logger::log(LogLevel::INFO, "All threads started successfully (" + 
+                   std::to_string(workers.size()) + " TUN pipelines, " +
+                   (io_engine == IoEngine::IO_URING ? "io_uring" : "epoll") + ")");
         
         // Give threads a moment to start
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -63,163 +139,810 @@ void Bridge::stop() {
     Logger::log(LogLevel::INFO, "Stopping Bridge...");
     
     should_stop = true;
-    queue_cv.notify_all();
+    for (auto& worker : workers) {
+        worker->encrypt_waiter.wakeup();
+        worker->decrypt_waiter.wakeup();
+        worker->loop.wakeup();
+    }
+    socket_loop.wakeup();
     
     // Join all threads
-    if (tun_reader_thread.joinable()) {
-        tun_reader_thread.join();
+    for (auto& worker : workers) {
+        if (worker->reader_thread.joinable()) {
+            worker->reader_thread.join();
+        }
+        if (worker->encrypt_thread.joinable()) {
+            worker->encrypt_thread.join();
+        }
+        if (worker->decrypt_thread.joinable()) {
+            worker->decrypt_thread.join();
+        }
     }
     if (socket_reader_thread.joinable()) {
         socket_reader_thread.join();
     }
-    if (packet_processor_thread.joinable()) {
-        packet_processor_thread.join();
-    }
     if (heartbeat_thread.joinable()) {
         heartbeat_thread.join();
     }
     
+    // Crypto workers go last: the pipelines and the stats thread use them
+    for (auto& worker : workers) {
+        worker->encrypt_pool.reset();
+        worker->decrypt_pool.reset();
+    }
+    
     Logger::log(LogLevel::INFO, "Bridge stopped");
 }
 
-void Bridge::tun_reader_loop() {
-    Logger::log(LogLevel::INFO, "TUN reader thread started");
+void Bridge::tun_reader_loop(TunWorker* worker) {
+    placement.apply(ThreadRole::TUN_READER, worker->queue_index, "ln-tun" + std::to_string(worker->queue_index));
+    Logger::log(LogLevel::INFO, "TUN reader thread started (queue " + std::to_string(worker->queue_index) + ")");
     
-    char buffer[2048];
-    fd_set read_fds;
-    struct timeval timeout;
+    // Register the queue fd once; stop() wakes the loop through its eventfd
+    int tun_fd = tun_manager->get_queue_fd(worker->queue_index);
+    if (tun_fd < 0 || !worker->loop.is_valid() || !worker->loop.add_fd(tun_fd)) {
+        Logger::log(LogLevel::ERROR, "TUN reader cannot watch queue " + std::to_string(worker->queue_index));
+        return;
+    }
+    
+    if (io_engine == IoEngine::IO_URING && tun_reader_loop_uring(worker, tun_fd)) {
+        worker->loop.remove_fd(tun_fd);
+        Logger::log(LogLevel::INFO, "TUN reader thread stopped (queue " + std::to_string(worker->queue_index) + ")");
+        return;
+    }
+    
+    int ready_fds[EventLoop::MAX_EVENTS];
+    
+    // Edge-triggered: the fd may already hold packets, so drain once up front
+    drain_tun_queue(worker);
     
     while (!should_stop) {
-        FD_ZERO(&read_fds);
-        FD_SET(tun_manager->get_fd(), &read_fds);
+        int result = worker->loop.wait(ready_fds, EventLoop::MAX_EVENTS);
         
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 100000; // 100ms timeout
+        if (result < 0) {
+            Logger::log(LogLevel::ERROR, "TUN epoll error: " + NetworkUtils::get_error_string(errno));
+            break;
+        }
         
-        int result = select(tun_manager->get_fd() + 1, &read_fds, nullptr, nullptr, &timeout);
+        for (int i = 0; i < result && !should_stop; i++) {
+            if (ready_fds[i] == tun_fd) {
+                drain_tun_queue(worker);
+            }
+        }
+    }
+    
+    worker->loop.remove_fd(tun_fd);
+    Logger::log(LogLevel::INFO, "TUN reader thread stopped (queue " + std::to_string(worker->queue_index) + ")");
+}
+
+bool Bridge::tun_reader_loop_uring(TunWorker* worker, int tun_fd) {
+    // Declared before the ring so they outlive it
+    PacketPtr slots[URING_TUN_READS];
+    UringEngine ring;
+    if (!ring.setup()) {
+        Logger::log(LogLevel::WARNING, "TUN queue " + std::to_string(worker->queue_index) + 
+                   " falling back to epoll");
+        return false;
+    }
+    
+    // Reads land straight in pooled buffers. The pool's regions are registered
+    // as fixed buffers; slots from regions added later use plain reads.
+    size_t read_size = tun_manager->get_read_size();
+    for (unsigned i = 0; i < URING_TUN_READS; i++) {
+        slots[i] = packet_pool.acquire(read_size);
+        if (!slots[i]) {
+            Logger::log(LogLevel::ERROR, "Packet pool exhausted, TUN queue " + std::to_string(worker->queue_index) + 
+                       " falling back to epoll");
+            return false;
+        }
+    }
+    std::vector<struct iovec> regions = packet_pool.get_regions();
+    size_t registered = ring.register_buffers(regions.data(), regions.size()) ? regions.size() : 0;
+    
+    auto post_read = [&](unsigned i) {
+        PacketBuffer* slot = slots[i].get();
+        if (slot->region < registered) {
+            ring.prep_read_fixed(tun_fd, slot->data(), read_size, slot->region, i);
+        } else {
+            ring.prep_read(tun_fd, slot->data(), read_size, i);
+        }
+    };
+    
+    // Keep every slot posted as a read; stop() signals the loop's eventfd
+    for (unsigned i = 0; i < URING_TUN_READS; i++) {
+        post_read(i);
+    }
+    ring.prep_poll_add(worker->loop.get_wakeup_fd(), POLLIN, URING_TAG_WAKEUP);
+    
+    while (!should_stop) {
+        if (ring.submit_and_wait(1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::log(LogLevel::ERROR, "TUN io_uring error: " + NetworkUtils::get_error_string(errno));
+            break;
+        }
         
-        if (result > 0 && FD_ISSET(tun_manager->get_fd(), &read_fds)) {
-            ssize_t bytes_read = tun_manager->read_packet(buffer, sizeof(buffer));
+        size_t queued = 0;
+        ring.reap([&](uint64_t tag, int result) {
+            if (tag == URING_TAG_WAKEUP || tag == URING_TAG_POLL) {
+                return;
+            }
             
-            if (bytes_read > 0) {
-                std::vector<uint8_t> packet_data(buffer, buffer + bytes_read);
-                auto packet = std::make_shared<Packet>(packet_data, Packet::TUN_TO_SOCKET);
-                
-                {
-                    std::lock_guard<std::mutex> lock(queue_mutex);
-                    packet_queue.push(packet);
+            unsigned i = static_cast<unsigned>(tag);
+            const char* data = slots[i]->data();
+            if (result > 0) {
+                size_t hdr_size = tun_manager->get_vnet_hdr_size();
+                if (static_cast<size_t>(result) > hdr_size &&
+                    tun_manager->validate_packet(data + hdr_size, result - hdr_size)) {
+                    // Hand the filled buffer over; without a replacement the packet is dropped
+                    PacketPtr replacement = packet_pool.acquire(read_size);
+                    if (replacement) {
+                        slots[i]->set_size(result);
+                        enqueue_packet(worker, std::move(slots[i]), false);
+                        slots[i] = std::move(replacement);
+                        queued++;
+                    } else {
+                        dropped_packets++;
+                    }
+                } else {
+                    Logger::log(LogLevel::WARNING, "Invalid packet received from TUN, dropping");
                 }
-                queue_cv.notify_one();
-                
-                Logger::log(LogLevel::DEBUG, "TUN packet queued: " + std::to_string(bytes_read) + " bytes");
+            } else if (result == -EAGAIN) {
+                // Kernels that honour O_NONBLOCK here: wait for readability first
+                ring.prep_poll_add(tun_fd, POLLIN, URING_TAG_POLL, true);
+            } else if (result < 0 && result != -EINTR) {
+                Logger::log(LogLevel::ERROR, "Failed to read from TUN: " + NetworkUtils::get_error_string(-result));
             }
-        } else if (result < 0 && errno != EINTR) {
-            Logger::log(LogLevel::ERROR, "TUN select error: " + NetworkUtils::get_error_string(errno));
-            break;
+            post_read(i);
+        });
+        
+        if (queued > 0) {
+            worker->encrypt_waiter.notify();
+            Logger::log(LogLevel::DEBUG, "TUN packets queued: " + std::to_string(queued));
+        }
+    }
+    
+    // The kernel writes into the slots until their reads are cancelled
+    uint64_t tags[URING_TUN_READS + 2] = {URING_TAG_WAKEUP, URING_TAG_POLL};
+    for (unsigned i = 0; i < URING_TUN_READS; i++) {
+        tags[i + 2] = i;
+    }
+    if (!ring.cancel_and_drain(tags, URING_TUN_READS + 2)) {
+        for (auto& slot : slots) {
+            slot.release();  // Leaked rather than handed out while still in use
+        }
+    }
+    return true;
+}
+
+void Bridge::drain_tun_queue(TunWorker* worker) {
+    // Large enough for a GSO super-packet in offload mode
+    size_t read_size = tun_manager->get_read_size();
+    std::vector<char> scratch;  // Only used to drop packets while the pool is exhausted
+    size_t queued = 0;
+    
+    while (!should_stop) {
+        PacketPtr packet = packet_pool.acquire(read_size);
+        char* buffer = packet ? packet->data() : nullptr;
+        if (!buffer) {
+            scratch.resize(read_size);
+            buffer = scratch.data();
+        }
+        
+        ssize_t bytes_read = tun_manager->read_packet(buffer, read_size, -1, worker->queue_index);
+        
+        if (bytes_read > 0) {
+            if (!packet) {
+                dropped_packets++;
+                continue;
+            }
+            packet->set_size(bytes_read);
+            enqueue_packet(worker, std::move(packet), false);
+            queued++;
+        } else if (bytes_read < 0 && errno == EINVAL) {
+            continue; // Invalid packet dropped, keep draining
+        } else {
+            break; // EAGAIN (drained) or read error
         }
     }
     
-    Logger::log(LogLevel::INFO, "TUN reader thread stopped");
+    if (queued > 0) {
+        worker->encrypt_waiter.notify();
+        Logger::log(LogLevel::DEBUG, "TUN packets queued: " + std::to_string(queued));
+    }
 }
 
 void Bridge::socket_reader_loop() {
+    placement.apply(ThreadRole::SOCKET_READER, 0, "ln-socket");
     Logger::log(LogLevel::INFO, "Socket reader thread started");
     
-    char buffer[2048];
-    fd_set read_fds;
-    struct timeval timeout;
+    // Frames are sliced out of large reads; partial frames carry over
+    FrameBuffer frames(crypto_manager ? FrameFormat::ENCRYPTED : FrameFormat::RAW_IP);
+    int ready_fds[EventLoop::MAX_EVENTS];
+    int watched_fd = -1;
+    
+    // UDP: every datagram is a frame, read in recvmmsg batches
+    // (fewer, larger slots when the kernel hands over coalesced datagrams)
+    bool datagram = socket_manager->is_datagram();
+    std::unique_ptr<DatagramBatch> datagrams;
+    if (datagram && socket_manager->has_udp_gro()) {
+        datagrams = std::make_unique<DatagramBatch>(UDP_GRO_BATCH_SIZE, UDP_GRO_MAX_DATAGRAM);
+    } else if (datagram) {
+        datagrams = std::make_unique<DatagramBatch>();
+    }
+    auto drain = [&]() {
+        return datagram ? drain_datagrams(*datagrams) : drain_socket(frames);
+    };
     
     while (!should_stop) {
+        // (Re-)register when the connection's fd changes
         int socket_fd = socket_manager->get_socket_fd();
-        if (socket_fd < 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            continue;
+        if (socket_fd != watched_fd) {
+            if (watched_fd >= 0) {
+                socket_loop.remove_fd(watched_fd);
+            }
+            watched_fd = -1;
+            frames.reset();
+            
+            // io_uring serves the connection until it ends, and the reader ends
+            // with it, as on the epoll path below (nothing reconnects)
+            if (socket_fd >= 0 && io_engine == IoEngine::IO_URING && !datagram &&
+                socket_reader_loop_uring(frames, socket_fd)) {
+                break;
+            }
+            
+            if (socket_fd >= 0 && socket_loop.add_fd(socket_fd)) {
+                watched_fd = socket_fd;
+                if (!drain()) {
+                    break;
+                }
+            }
         }
         
-        FD_ZERO(&read_fds);
-        FD_SET(socket_fd, &read_fds);
+        // Without a connection, poll for one every 100ms (stop() still wakes us)
+        int result = socket_loop.wait(ready_fds, EventLoop::MAX_EVENTS, watched_fd >= 0 ? -1 : 100);
         
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 100000; // 100ms timeout
+        if (result < 0) {
+            Logger::log(LogLevel::ERROR, "Socket epoll error: " + NetworkUtils::get_error_string(errno));
+            break;
+        }
         
-        int result = select(socket_fd + 1, &read_fds, nullptr, nullptr, &timeout);
+        bool connection_ok = true;
+        for (int i = 0; i < result && connection_ok; i++) {
+            if (ready_fds[i] == watched_fd) {
+                connection_ok = drain();
+            }
+        }
+        if (!connection_ok) {
+            break;
+        }
+    }
+    
+    if (watched_fd >= 0) {
+        socket_loop.remove_fd(watched_fd);
+    }
+    Logger::log(LogLevel::INFO, "Socket reader thread stopped");
+}
+
+bool Bridge::socket_reader_loop_uring(FrameBuffer& frames, int socket_fd) {
+    UringEngine ring;
+    if (!ring.setup()) {
+        Logger::log(LogLevel::WARNING, "Socket reader falling back to epoll");
+        return false;
+    }
+    
+    // Reads land directly in the reassembly buffer
+    struct iovec iov;
+    iov.iov_base = frames.data();
+    iov.iov_len = frames.capacity();
+    bool fixed = ring.register_buffers(&iov, 1);
+    
+    auto post_read = [&]() {
+        if (fixed) {
+            ring.prep_read_fixed(socket_fd, frames.write_ptr(), frames.write_space(), 0, 0);
+        } else {
+            ring.prep_read(socket_fd, frames.write_ptr(), frames.write_space(), 0);
+        }
+    };
+    
+    post_read();
+    ring.prep_poll_add(socket_loop.get_wakeup_fd(), POLLIN, URING_TAG_WAKEUP);
+    
+    bool connection_ok = true;
+    while (!should_stop && connection_ok) {
+        if (ring.submit_and_wait(1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::log(LogLevel::ERROR, "Socket io_uring error: " + NetworkUtils::get_error_string(errno));
+            break;
+        }
         
-        if (result > 0 && FD_ISSET(socket_fd, &read_fds)) {
-            ssize_t bytes_read = socket_manager->receive_data(buffer, sizeof(buffer));
+        ring.reap([&](uint64_t tag, int result) {
+            if (tag == URING_TAG_WAKEUP || tag == URING_TAG_POLL || !connection_ok) {
+                return;
+            }
             
-            if (bytes_read > 0) {
-                std::vector<uint8_t> packet_data(buffer, buffer + bytes_read);
-                auto packet = std::make_shared<Packet>(packet_data, Packet::SOCKET_TO_TUN);
-                
-                {
-                    std::lock_guard<std::mutex> lock(queue_mutex);
-                    packet_queue.push(packet);
+            if (result > 0) {
+                frames.commit(result);
+                if (!dispatch_socket_frames(frames)) {
+                    Logger::log(LogLevel::ERROR, "Socket stream out of sync, closing connection");
+                    socket_manager->close_connection();
+                    connection_ok = false;
+                    return;
                 }
-                queue_cv.notify_one();
-                
-                Logger::log(LogLevel::DEBUG, "Socket packet queued: " + std::to_string(bytes_read) + " bytes");
-            } else if (bytes_read == 0) {
+            } else if (result == 0) {
                 Logger::log(LogLevel::WARNING, "Socket connection closed by remote");
-                break;
+                connection_ok = false;
+                return;
+            } else if (result == -EAGAIN) {
+                ring.prep_poll_add(socket_fd, POLLIN, URING_TAG_POLL, true);
+            } else if (result != -EINTR) {
+                Logger::log(LogLevel::ERROR, "Failed to receive data: " + NetworkUtils::get_error_string(-result));
+                connection_ok = false;
+                return;
             }
-        } else if (result < 0 && errno != EINTR) {
-            Logger::log(LogLevel::ERROR, "Socket select error: " + NetworkUtils::get_error_string(errno));
-            break;
+            post_read();
+        });
+    }
+    
+    // The read targets the caller's reassembly buffer; finish it before returning
+    const uint64_t tags[] = {0, URING_TAG_WAKEUP, URING_TAG_POLL};
+    ring.cancel_and_drain(tags, 3);
+    return true;
+}
+
+bool Bridge::drain_socket(FrameBuffer& frames) {
+    while (!should_stop) {
+        ssize_t bytes_read = socket_manager->receive_data(frames.write_ptr(), frames.write_space(), true);
+        
+        if (bytes_read > 0) {
+            frames.commit(bytes_read);
+            
+            if (!dispatch_socket_frames(frames)) {
+                Logger::log(LogLevel::ERROR, "Socket stream out of sync, closing connection");
+                socket_manager->close_connection();
+                return false;
+            }
+        } else if (bytes_read == 0) {
+            Logger::log(LogLevel::WARNING, "Socket connection closed by remote");
+            return false;
+        } else {
+            // EAGAIN means drained; anything else has already marked the socket down
+            return socket_manager->is_socket_connected();
         }
     }
     
-    Logger::log(LogLevel::INFO, "Socket reader thread stopped");
+    return true;
 }
 
-void Bridge::packet_processor_loop() {
-    Logger::log(LogLevel::INFO, "Packet processor thread started");
+bool Bridge::drain_datagrams(DatagramBatch& datagrams) {
+    // Data packets go to the pipeline of their sender's lane, which writes
+    // them to its own TUN queue; each lane stays in order. Auth messages and
+    // unencrypted frames (no lane) go to the first pipeline.
+    std::vector<size_t> queued(workers.size(), 0);
     
     while (!should_stop) {
-        std::shared_ptr<Packet> packet;
+        int received = socket_manager->receive_datagrams(datagrams);
+        if (received < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
         
-        // Wait for packet
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            queue_cv.wait(lock, [this] { return !packet_queue.empty() || should_stop; });
-            
-            if (should_stop) break;
+        size_t frame_count = 0;
+        for (int i = 0; i < received; i++) {
+            if (datagrams.truncated(i) || datagrams.size(i) == 0) {
+                dropped_packets++;
+                continue;
+            }
             
-            if (!packet_queue.empty()) {
-                packet = packet_queue.front();
-                packet_queue.pop();
-            } else {
+            // A coalesced slot holds equal-sized frames, the last one possibly shorter
+            const char* data = datagrams.data(i);
+            size_t size = datagrams.size(i);
+            size_t segment_size = datagrams.segment_size(i);
+            for (size_t offset = 0; offset < size; offset += segment_size) {
+                size_t frame_size = std::min(segment_size, size - offset);
+                PacketPtr packet = packet_pool.acquire(frame_size, PacketDirection::SOCKET_TO_TUN);
+                if (!packet) {
+                    dropped_packets++;
+                    continue;
+                }
+                memcpy(packet->data(), data + offset, frame_size);
+                packet->set_size(frame_size);
+                packet->source = datagrams.source(i);
+                
+                size_t lane = 0;
+                const EncryptedHeader* header = reinterpret_cast<const EncryptedHeader*>(packet->data());
+                if (crypto_manager && frame_size >= sizeof(EncryptedHeader) &&
+                    header->packet_type == (uint8_t)PacketType::DATA_PACKET) {
+                    lane = data_packet_lane(header) % workers.size();
+                }
+                enqueue_packet(workers[lane].get(), std::move(packet), false);
+                queued[lane]++;
+                frame_count++;
+            }
+        }
+        
+        if (frame_count > 0) {
+            for (size_t lane = 0; lane < workers.size(); lane++) {
+                if (queued[lane] > 0) {
+                    workers[lane]->decrypt_waiter.notify();
+                    queued[lane] = 0;
+                }
+            }
+            Logger::log(LogLevel::DEBUG, "Socket datagrams queued: " + std::to_string(frame_count));
+        }
+        if (static_cast<size_t>(received) < datagrams.capacity()) {
+            return true;  // Short batch: the socket is drained
+        }
+    }
+    
+    return true;
+}
+
+bool Bridge::dispatch_socket_frames(FrameBuffer& frames) {
+    const char* frame;
+    size_t frame_size;
+    FrameBuffer::Status status;
+    size_t frame_count = 0;
+    
+    // One stream, in order: the decrypt/write side runs on the first pipeline
+    TunWorker* worker = workers.front().get();
+    
+    while ((status = frames.next_frame(frame, frame_size)) == FrameBuffer::Status::FRAME) {
+        PacketPtr packet = packet_pool.acquire(frame_size, PacketDirection::SOCKET_TO_TUN);
+        if (!packet) {
+            dropped_packets++;
+            continue;
+        }
+        memcpy(packet->data(), frame, frame_size);
+        packet->set_size(frame_size);
+        enqueue_packet(worker, std::move(packet), false);
+        frame_count++;
+    }
+    
+    if (frame_count > 0) {
+        worker->decrypt_waiter.notify();
+        Logger::log(LogLevel::DEBUG, "Socket frames queued: " + std::to_string(frame_count));
+    }
+    
+    if (status == FrameBuffer::Status::INVALID) {
+        frames.reset();
+        return false;
+    }
+    
+    // Keep the partial frame and make room for the next read
+    frames.compact();
+    return true;
+}
+
+bool Bridge::enqueue_packet(TunWorker* worker, PacketPtr packet, bool notify) {
+    PacketDirection packet_direction = packet->direction;
+    
+    // Hash the flow here on the reader thread, for the encrypt workers
+    if (packet_direction == PacketDirection::TUN_TO_SOCKET && flow_hasher.is_enabled()) {
+        size_t hdr_size = tun_manager->get_vnet_hdr_size();
+        if (packet->size() > hdr_size) {
+            packet->flow_hash = flow_hasher.hash(packet->data() + hdr_size, packet->size() - hdr_size);
+        }
+    }
+    
+    SpscRing<PacketPtr>& ring = packet_direction == PacketDirection::TUN_TO_SOCKET ? 
+                                worker->tun_ring : worker->socket_ring;
+    if (!ring.push(std::move(packet))) {
+        dropped_packets++;
+        return false;
+    }
+    if (notify) {
+        RingWaiter& waiter = packet_direction == PacketDirection::TUN_TO_SOCKET ? 
+                             worker->encrypt_waiter : worker->decrypt_waiter;
+        waiter.notify();
+    }
+    return true;
+}
+
+// Earliest of two wait timeouts in microseconds, -1 meaning none
+static long earliest_timeout(long a, long b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return std::min(a, b);
+}
+
+void Bridge::encrypt_loop(TunWorker* worker) {
+    placement.apply(ThreadRole::ENCRYPT, worker->queue_index, "ln-enc" + std::to_string(worker->queue_index));
+    Logger::log(LogLevel::INFO, "Encrypt pipeline started (queue " + std::to_string(worker->queue_index) + ")");
+    
+    // Wrapped frames leave in batches according to the flush policy
+    TxBatcher tx(tx_policy);
+    
+    // Optionally wrap on worker threads; frames still leave in TUN order
+    // (per flow when steered). Otherwise each batch is wrapped here as a burst.
+    CryptoPool* crypto_pool = worker->encrypt_pool.get();
+    std::vector<CryptoJob> jobs;
+    std::vector<CryptoJob> burst;
+    burst.reserve(URING_BATCH_SIZE);
+    
+    auto send_wrapped = [&](std::vector<CryptoJob>& done) {
+        for (auto& job : done) {
+            if (job.ok) {
+                packets_processed++;
+                update_statistics(job.input_size);
+                tx.add(std::move(job.packet));
+                if (tx.full()) {
+                    flush_tx(tx);
+                }
+            } else if (!job.packet) {
+                dropped_packets++;
+            }
+        }
+        done.clear();
+    };
+    
+    auto release_wrapped = [&]() {
+        crypto_pool->collect(jobs);
+        send_wrapped(jobs);
+    };
+    
+    std::vector<PacketPtr> packets;
+    packets.reserve(URING_BATCH_SIZE);
+    
+    auto ready = [this, worker, crypto_pool] {
+        return !worker->tun_ring.empty() || (crypto_pool && crypto_pool->has_completions()) || should_stop;
+    };
+    
+    while (!should_stop) {
+        // Wait for packets (spin, then park on the eventfd); staged frames
+        // only wait until their flush deadline, pooled ones until they time
+        // out. Zero-copy buffers go back to the pool even without traffic:
+        // the TUN reader may need them to produce any.
+        long timeout = tx.empty() ? -1 : tx.time_left().count();
+        if (crypto_pool && !crypto_pool->idle()) {
+            timeout = earliest_timeout(timeout, crypto_pool->time_left());
+        }
+        if (tx.zerocopy_pending()) {
+            timeout = earliest_timeout(timeout, TX_RECLAIM_USEC);
+        }
+        if (!worker->encrypt_waiter.wait(ready, timeout)) {
+            if (crypto_pool) {
+                release_wrapped();
+            }
+            if (tx.zerocopy_pending()) {
+                tx.reclaim(socket_manager);
+            }
+            if (timeout >= 0) {
+                flush_tx(tx);
+            }
+            continue;
+        }
+        
+        if (should_stop) break;
+        
+        worker->tun_ring.pop_batch(packets, URING_BATCH_SIZE);
+        for (auto& packet : packets) {
+            process_tun_packet(std::move(packet), burst, crypto_pool);
+        }
+        packets.clear();
+        
+        if (crypto_pool) {
+            release_wrapped();
+        } else if (!burst.empty()) {
+            if (crypto_manager) {
+                wrap_jobs(burst.data(), burst.size(), worker->queue_index);
+            }
+            send_wrapped(burst);
+        }
+        
+        if (!tx.empty() && tx.time_left().count() == 0) {
+            flush_tx(tx);
+        }
+    }
+    
+    Logger::log(LogLevel::INFO, "Encrypt pipeline stopped (queue " + std::to_string(worker->queue_index) + ")");
+}
+
+void Bridge::decrypt_loop(TunWorker* worker) {
+    placement.apply(ThreadRole::DECRYPT, worker->queue_index, "ln-dec" + std::to_string(worker->queue_index));
+    Logger::log(LogLevel::INFO, "Decrypt pipeline started (queue " + std::to_string(worker->queue_index) + ")");
+    
+    // With io_uring, the TUN writes of a whole batch go out in one submission
+    UringEngine ring;
+    bool use_uring = io_engine == IoEngine::IO_URING && ring.setup();
+    IoBatch io_batch;
+    IoBatch* batch = use_uring ? &io_batch : nullptr;
+    
+    // Offload mode: merge TCP segments headed for TUN into GSO writes
+    size_t queue = worker->queue_index;
+    std::unique_ptr<GroCoalescer> gro;
+    if (tun_manager->has_vnet_hdr()) {
+        gro = std::make_unique<GroCoalescer>([this, queue, batch](const VnetHdr* hdr, const char* data, size_t size) {
+            return write_tun_output(hdr, data, size, queue, batch);
+        });
+    }
+    
+    // Optionally unwrap on worker threads; packets still reach TUN in socket order.
+    // Otherwise runs of data packets are unwrapped here as a burst.
+    CryptoPool* crypto_pool = worker->decrypt_pool.get();
+    std::vector<CryptoJob> jobs;
+    std::vector<CryptoJob> burst;
+    burst.reserve(URING_BATCH_SIZE);
+    
+    auto deliver_jobs = [&](std::vector<CryptoJob>& done) {
+        for (auto& job : done) {
+            if (job.ok) {
+                if (deliver_unwrapped(*job.packet, queue, batch, gro.get())) {
+                    packets_processed++;
+                    update_statistics(job.packet->size());
+                }
+            } else if (!job.packet) {
+                dropped_packets++;
+            }
+        }
+        done.clear();
+    };
+    
+    auto release_unwrapped = [&]() {
+        crypto_pool->collect(jobs);
+        deliver_jobs(jobs);
+    };
+    
+    // Wait until everything submitted so far is delivered (or given up)
+    auto drain_unwrapped = [&]() {
+        release_unwrapped();
+        while (!crypto_pool->idle() && !should_stop) {
+            worker->decrypt_waiter.wait([this, crypto_pool] {
+                return crypto_pool->has_completions() || should_stop;
+            }, crypto_pool->time_left());
+            release_unwrapped();
+        }
+    };
+    
+    auto unwrap_burst = [&]() {
+        unwrap_jobs(burst.data(), burst.size());
+        deliver_jobs(burst);
+    };
+    
+    std::vector<PacketPtr> packets;
+    packets.reserve(URING_BATCH_SIZE);
+    
+    auto ready = [this, worker, crypto_pool] {
+        return !worker->socket_ring.empty() || (crypto_pool && crypto_pool->has_completions()) || should_stop;
+    };
+    
+    while (!should_stop) {
+        // Held segments wait only briefly for their successors, then go out
+        long timeout = gro && gro->has_pending() ? GRO_FLUSH_USEC : -1;
+        if (crypto_pool && !crypto_pool->idle()) {
+            timeout = earliest_timeout(timeout, crypto_pool->time_left());
+        }
+        if (!worker->decrypt_waiter.wait(ready, timeout)) {
+            if (crypto_pool) {
+                release_unwrapped();
+            }
+            if (gro) {
+                gro->flush();
+            }
+            if (batch && !batch->empty()) {
+                flush_io_batch(ring, *batch, queue);
+            }
+            continue;
+        }
+        
+        if (should_stop) break;
+        
+        worker->socket_ring.pop_batch(packets, URING_BATCH_SIZE);
+        for (auto& packet : packets) {
+            if (crypto_manager && is_authenticated && !is_auth_packet(*packet)) {
+                if (crypto_pool) {
+                    crypto_pool->submit(std::move(packet));
+                } else {
+                    size_t packet_size = packet->size();
+                    burst.push_back(CryptoJob{0, std::move(packet), packet_size, false});
+                }
                 continue;
             }
+            
+            // Data packets before an auth message are unwrapped first, so a
+            // re-handshake cannot switch keys under them
+            if (crypto_pool) {
+                drain_unwrapped();
+            } else if (!burst.empty()) {
+                unwrap_burst();
+            }
+            if (process_socket_packet(*packet, queue, batch, gro.get())) {
+                packets_processed++;
+                update_statistics(packet->size());
+            }
         }
+        packets.clear();
         
-        // Process packet
-        bool success = false;
-        if (packet->type == Packet::TUN_TO_SOCKET) {
-            success = process_tun_packet(packet->data);
-        } else {
-            success = process_socket_packet(packet->data);
+        if (crypto_pool) {
+            release_unwrapped();
+        } else if (!burst.empty()) {
+            unwrap_burst();
+        }
+        
+        if (gro) {
+            gro->flush_expired();
         }
         
-        if (success) {
-            packets_processed++;
-            update_statistics(packet->data.size());
+        if (batch && !batch->empty()) {
+            flush_io_batch(ring, *batch, queue);
         }
     }
     
-    Logger::log(LogLevel::INFO, "Packet processor thread stopped");
+    if (gro) {
+        gro->flush();
+    }
+    
+    Logger::log(LogLevel::INFO, "Decrypt pipeline stopped (queue " + std::to_string(worker->queue_index) + ")");
+}
+
+void Bridge::flush_tx(TxBatcher& tx) {
+    if (tx.empty()) {
+        return;
+    }
+    
+    size_t frames = tx.size();
+    if (tx.flush(socket_manager) <= 0) {
+        Logger::log(LogLevel::WARNING, "Failed to send wrapped packets to socket");
+        dropped_packets += frames;
+    }
+}
+
+void Bridge::flush_io_batch(UringEngine& ring, IoBatch& batch, size_t queue) {
+    // TUN writes: one SQE per packet, one syscall for the lot
+    int tun_fd = tun_manager->get_queue_fd(queue);
+    unsigned queued = 0;
+    for (size_t i = 0; i < batch.tun_packets.size(); i++) {
+        const PacketBuffer& packet = *batch.tun_packets[i];
+        if (ring.prep_write(tun_fd, packet.data(), packet.size(), i)) {
+            queued++;
+        }
+    }
+    
+    if (ring.submit_and_wait(queued) >= 0) {
+        ring.reap([this](uint64_t, int result) {
+            if (result < 0) {
+                Logger::log(LogLevel::WARNING, "Failed to write unwrapped packet to TUN: " + 
+                           NetworkUtils::get_error_string(-result));
+                dropped_packets++;
+            }
+        });
+    } else {
+        Logger::log(LogLevel::ERROR, "TUN io_uring submit failed: " + NetworkUtils::get_error_string(errno));
+        dropped_packets += batch.tun_packets.size();
+    }
+    
+    batch.clear();
 }
 
 void Bridge::heartbeat_loop() {
+    placement.apply(ThreadRole::HEARTBEAT, 0, "ln-heartbeat");
     Logger::log(LogLevel::INFO, "Heartbeat thread started");
     
     auto last_heartbeat = std::chrono::steady_clock::now();
     auto last_stats = std::chrono::steady_clock::now();
+    auto last_auth = std::chrono::steady_clock::now();
     
     while (!should_stop) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         
         auto now = std::chrono::steady_clock::now();
         
+        // Datagrams get lost: repeat the auth request until the server answers
+        if (mode == "client" && crypto_manager && socket_manager->is_datagram() && !is_authenticated &&
+            std::chrono::duration_cast<std::chrono::seconds>(now - last_auth).count() >= AUTH_RETRY_SECONDS) {
+            Logger::log(LogLevel::INFO, "No authentication response, retrying");
+            auth_in_progress = false;
+            handle_authentication();
+            last_auth = now;
+        }
+        
+        // Next data keys are derived here, away from the data path
+        if (crypto_manager && is_authenticated) {
+            crypto_manager->rotate_keys();
+        }
+        
         // Send encrypted keepalive every 10 seconds
         if (std::chrono::duration_cast<std::chrono::seconds>(now - last_heartbeat).count() >= 10) {
             if (is_authenticated && socket_manager->get_socket_fd() >= 0 && crypto_manager) {
@@ -249,65 +972,145 @@ void Bridge::heartbeat_loop() {
     Logger::log(LogLevel::INFO, "Heartbeat thread stopped");
 }
 
-bool Bridge::process_tun_packet(const std::vector<uint8_t>& packet) {
+bool Bridge::process_tun_packet(PacketPtr packet, std::vector<CryptoJob>& burst, CryptoPool* crypto_pool) {
     if (!is_authenticated) {
         return false;
     }
     
-    try {
-        if (crypto_manager) {
-            // Use CryptoManager's proper wrap_data_packet (includes HMAC verification)
-            size_t max_wrapped_size = packet.size() + 128; // Extra space for header, IV, padding, HMAC
-            std::vector<char> wrapped_buffer(max_wrapped_size);
-            size_t wrapped_size = max_wrapped_size;
-            
-            if (!crypto_manager->wrap_data_packet(reinterpret_cast<const char*>(packet.data()), 
-                                                 packet.size(), wrapped_buffer.data(), wrapped_size)) {
-                Logger::log(LogLevel::ERROR, "Failed to wrap TUN packet, size: " + std::to_string(packet.size()));
-                return false;
-            }
-            
-            Logger::log(LogLevel::DEBUG, "Wrapped packet: " + std::to_string(packet.size()) + " -> " + std::to_string(wrapped_size) + " bytes");
-            
-            if (socket_manager->send_data(wrapped_buffer.data(), wrapped_size) <= 0) {
-                Logger::log(LogLevel::WARNING, "Failed to send wrapped packet to socket");
-                return false;
-            }
-        } else {
-            // Send unencrypted
-            if (socket_manager->send_data(reinterpret_cast<const char*>(packet.data()), packet.size()) <= 0) {
-                Logger::log(LogLevel::WARNING, "Failed to send packet to socket");
-                return false;
+    size_t hdr_size = tun_manager->get_vnet_hdr_size();
+    if (hdr_size == 0 || tx_gso) {
+        // Plain packet, or a super-packet the peer takes whole (header included)
+        return forward_to_socket(std::move(packet), burst, crypto_pool);
+    }
+    
+    // Offload mode towards a peer without GSO support: segment here
+    const char* data = packet->data();
+    VnetHdr hdr;
+    memcpy(&hdr, data, hdr_size);
+    std::vector<std::vector<char>> segments;
+    if (!GsoSegmenter::segment(hdr, data + hdr_size, packet->size() - hdr_size, segments)) {
+        Logger::log(LogLevel::WARNING, "Malformed GSO packet from TUN, dropping");
+        return false;
+    }
+    
+    for (const auto& segment : segments) {
+        PacketPtr segment_packet = packet_pool.acquire(segment.size());
+        if (!segment_packet) {
+            dropped_packets++;
+            return false;
+        }
+        memcpy(segment_packet->data(), segment.data(), segment.size());
+        segment_packet->set_size(segment.size());
+        segment_packet->flow_hash = packet->flow_hash;
+        if (!forward_to_socket(std::move(segment_packet), burst, crypto_pool)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Bridge::forward_to_socket(PacketPtr packet, std::vector<CryptoJob>& burst, CryptoPool* crypto_pool) {
+    if (crypto_pool) {
+        if (!crypto_pool->submit(std::move(packet))) {
+            dropped_packets++;
+            return false;
+        }
+        return true;
+    }
+    
+    // Wrapped with the rest of the batch (sent as is without encryption)
+    size_t packet_size = packet->size();
+    burst.push_back(CryptoJob{0, std::move(packet), packet_size, !crypto_manager});
+    return true;
+}
+
+void Bridge::wrap_jobs(CryptoJob* jobs, size_t count, size_t queue) {
+    CryptoBurstItem items[CRYPTO_BURST_MAX];
+    CryptoJob* item_jobs[CRYPTO_BURST_MAX];
+    size_t i = 0;
+    while (i < count) {
+        // Encrypt in place: each header goes into its packet's headroom
+        size_t item_count = 0;
+        for (; i < count && item_count < CRYPTO_BURST_MAX; i++) {
+            PacketBuffer& packet = *jobs[i].packet;
+            if (packet.headroom() < WRAP_HEADROOM) {
+                Logger::log(LogLevel::ERROR, "No room to wrap TUN packet in place");
+                jobs[i].ok = false;
+                continue;
             }
+            items[item_count] = {packet.data(), packet.size(), false};
+            item_jobs[item_count++] = &jobs[i];
         }
+        crypto_manager->wrap_burst(items, item_count, static_cast<uint8_t>(queue));
         
-        return true;
-    } catch (const std::exception& e) {
-        Logger::log(LogLevel::ERROR, "Exception in process_tun_packet: " + std::string(e.what()));
-        return false;
+        for (size_t j = 0; j < item_count; j++) {
+            PacketBuffer& packet = *item_jobs[j]->packet;
+            item_jobs[j]->ok = items[j].ok;
+            if (!items[j].ok) {
+                Logger::log(LogLevel::ERROR, "Failed to wrap TUN packet, size: " + std::to_string(packet.size()));
+                continue;
+            }
+            packet.push(WRAP_HEADROOM);
+            packet.set_size(items[j].size);
+        }
     }
 }
 
-bool Bridge::process_socket_packet(const std::vector<uint8_t>& packet) {
-    // Check if this is an authentication packet (check packet structure properly)
-    if (packet.size() >= sizeof(EncryptedHeader)) {
-        uint8_t packet_type = packet[0];
-        // Check for CryptoManager authentication packet types and validate size
-        if ((packet_type == 0x01 || packet_type == 0x02 || packet_type == 0x03 || packet_type == 0x04)) {
-            // Additional validation: check if this looks like a real auth packet
-            const EncryptedHeader* header = reinterpret_cast<const EncryptedHeader*>(packet.data());
-            uint32_t data_length = ntohl(header->data_length);
-            
-            // Validate packet structure
-            if (packet.size() == sizeof(EncryptedHeader) + data_length) {
-                Logger::log(LogLevel::DEBUG, "Detected auth packet type: 0x" + std::to_string(packet_type) + 
-                           ", size: " + std::to_string(packet.size()));
-                return handle_auth_packet(packet);
-            } else {
-                Logger::log(LogLevel::DEBUG, "Invalid auth packet structure, treating as data packet");
+void Bridge::unwrap_jobs(CryptoJob* jobs, size_t count) {
+    CryptoBurstItem items[CRYPTO_BURST_MAX];
+    for (size_t start = 0; start < count; start += CRYPTO_BURST_MAX) {
+        size_t end = std::min(count, start + CRYPTO_BURST_MAX);
+        
+        // Decrypt in place: the plaintext replaces the ciphertext
+        for (size_t i = start; i < end; i++) {
+            PacketBuffer& packet = *jobs[i].packet;
+            items[i - start] = {packet.data(), packet.size(), false};
+        }
+        crypto_manager->unwrap_burst(items, end - start);
+        
+        for (size_t i = start; i < end; i++) {
+            PacketBuffer& packet = *jobs[i].packet;
+            jobs[i].ok = items[i - start].ok;
+            if (!jobs[i].ok) {
+                Logger::log(LogLevel::ERROR, "Failed to unwrap socket packet, size: " + std::to_string(packet.size()) + " (tag mismatch, replay or PSK mismatch)");
+                continue;
             }
+            packet.pull(WRAP_HEADROOM);
+            packet.set_size(items[i - start].size);
         }
     }
+}
+
+bool Bridge::is_auth_packet(const PacketBuffer& packet) const {
+    // Check if this is an authentication packet (check packet structure properly)
+    if (packet.size() < sizeof(EncryptedHeader)) {
+        return false;
+    }
+    
+    uint8_t packet_type = static_cast<uint8_t>(packet.data()[0]);
+    // Check for CryptoManager authentication packet types and validate size
+    if (packet_type < (uint8_t)PacketType::AUTH_REQUEST || packet_type > (uint8_t)PacketType::AUTH_CONFIRM) {
+        return false;
+    }
+    
+    // Additional validation: check if this looks like a real auth packet
+    const EncryptedHeader* header = reinterpret_cast<const EncryptedHeader*>(packet.data());
+    uint32_t data_length = ntohl(header->data_length);
+    if (packet.size() != sizeof(EncryptedHeader) + data_length) {
+        Logger::log(LogLevel::DEBUG, "Invalid auth packet structure, treating as data packet");
+        return false;
+    }
+    
+    Logger::log(LogLevel::DEBUG, "Detected auth packet type: 0x" + std::to_string(packet_type) + 
+               ", size: " + std::to_string(packet.size()));
+    return true;
+}
+
+bool Bridge::process_socket_packet(PacketBuffer& packet, size_t queue, IoBatch* batch,
+                                   GroCoalescer* gro) {
+    if (is_auth_packet(packet)) {
+        return handle_auth_packet(packet);
+    }
     
     if (!is_authenticated) {
         Logger::log(LogLevel::WARNING, "Received data packet before authentication complete, dropping");
@@ -316,43 +1119,12 @@ bool Bridge::process_socket_packet(const std::vector<uint8_t>& packet) {
     
     try {
         if (crypto_manager) {
-            // Decrypt and check if it's a keepalive or data packet
-            size_t max_unwrapped_size = packet.size() + 64;
-            std::vector<char> unwrapped_buffer(max_unwrapped_size);
-            size_t unwrapped_size = max_unwrapped_size;
-            
-            if (!crypto_manager->unwrap_data_packet(reinterpret_cast<const char*>(packet.data()), 
-                                                   packet.size(), unwrapped_buffer.data(), unwrapped_size)) {
-                Logger::log(LogLevel::ERROR, "Failed to unwrap socket packet, size: " + std::to_string(packet.size()) + " (HMAC verification failed or PSK mismatch)");
-                return false;
-            }
-            
-            Logger::log(LogLevel::DEBUG, "Unwrapped packet: " + std::to_string(packet.size()) + " -> " + std::to_string(unwrapped_size) + " bytes");
-            
-            // Check if this is a keepalive packet
-            if (unwrapped_size >= 9 && std::string(unwrapped_buffer.data(), 9) == "KEEPALIVE") {
-                Logger::log(LogLevel::DEBUG, "Encrypted keepalive received and processed");
-                return true;
-            }
-            
-            // Debug: Check unwrapped data validity for IP packets
-            if (unwrapped_size > 0) {
-                uint8_t version = (unwrapped_buffer[0] >> 4) & 0x0F;
-                Logger::log(LogLevel::DEBUG, "Unwrapped packet IP version: " + std::to_string(version) + 
-                           ", first bytes: " + std::to_string((uint8_t)unwrapped_buffer[0]) + " " + 
-                           (unwrapped_size > 1 ? std::to_string((uint8_t)unwrapped_buffer[1]) : "N/A"));
-            }
-            
-            // Write to TUN as normal IP packet
-            if (tun_manager->write_packet(unwrapped_buffer.data(), unwrapped_size) <= 0) {
-                Logger::log(LogLevel::WARNING, "Failed to write unwrapped packet to TUN");
-                return false;
-            }
-            
-            return true;
+            return unwrap_packet(packet) && deliver_unwrapped(packet, queue, batch, gro);
+        } else if (batch) {
+            return stage_tun_packet(batch, packet.data(), packet.size());
         } else {
             // Write unencrypted
-            if (tun_manager->write_packet(reinterpret_cast<const char*>(packet.data()), packet.size()) <= 0) {
+            if (tun_manager->write_packet(packet.data(), packet.size(), queue) <= 0) {
                 Logger::log(LogLevel::WARNING, "Failed to write packet to TUN");
                 return false;
             }
@@ -365,6 +1137,153 @@ bool Bridge::process_socket_packet(const std::vector<uint8_t>& packet) {
     }
 }
 
+bool Bridge::unwrap_packet(PacketBuffer& packet) {
+    // Decrypt in place: the plaintext replaces the ciphertext
+    size_t wrapped_size = packet.size();
+    size_t unwrapped_size = 0;
+    
+    if (!crypto_manager->unwrap_in_place(packet.data(), wrapped_size, unwrapped_size)) {
+        Logger::log(LogLevel::ERROR, "Failed to unwrap socket packet, size: " + std::to_string(wrapped_size) + " (tag mismatch or PSK mismatch)");
+        return false;
+    }
+    
+    Logger::log(LogLevel::DEBUG, "Unwrapped packet: " + std::to_string(wrapped_size) + " -> " + std::to_string(unwrapped_size) + " bytes");
+    packet.pull(WRAP_HEADROOM);
+    packet.set_size(unwrapped_size);
+    return true;
+}
+
+bool Bridge::deliver_unwrapped(PacketBuffer& packet, size_t queue, IoBatch* batch, GroCoalescer* gro) {
+    learn_peer(packet);
+    const char* unwrapped_buffer = packet.data();
+    size_t unwrapped_size = packet.size();
+    
+    // Check if this is a keepalive packet
+    if (unwrapped_size >= 9 && std::string(unwrapped_buffer, 9) == "KEEPALIVE") {
+        Logger::log(LogLevel::DEBUG, "Encrypted keepalive received and processed");
+        return true;
+    }
+    
+    // Debug: Check unwrapped data validity for IP packets
+    if (unwrapped_size > 0) {
+        uint8_t version = (unwrapped_buffer[0] >> 4) & 0x0F;
+        Logger::log(LogLevel::DEBUG, "Unwrapped packet IP version: " + std::to_string(version) + 
+                   ", first bytes: " + std::to_string((uint8_t)unwrapped_buffer[0]) + " " + 
+                   (unwrapped_size > 1 ? std::to_string((uint8_t)unwrapped_buffer[1]) : "N/A"));
+    }
+    
+    return deliver_to_tun(unwrapped_buffer, unwrapped_size, queue, batch, gro);
+}
+
+bool Bridge::deliver_to_tun(const char* data, size_t size, size_t queue, IoBatch* batch, GroCoalescer* gro) {
+    if (!rx_gso) {
+        return write_tun_packet(data, size, queue, batch, gro);
+    }
+    
+    // Peer payloads carry a virtio_net_hdr
+    if (size <= VNET_HDR_SIZE) {
+        Logger::log(LogLevel::WARNING, "Truncated GSO payload from peer, dropping");
+        return false;
+    }
+    VnetHdr hdr;
+    memcpy(&hdr, data, VNET_HDR_SIZE);
+    data += VNET_HDR_SIZE;
+    size -= VNET_HDR_SIZE;
+    
+    if (tun_manager->has_vnet_hdr()) {
+        // Both sides offload: hand the super-packet to the kernel as GSO,
+        // behind anything still held for merging
+        if (gro) {
+            gro->flush();
+        }
+        return write_tun_output(&hdr, data, size, queue, batch);
+    }
+    
+    std::vector<std::vector<char>> segments;
+    if (!GsoSegmenter::segment(hdr, data, size, segments)) {
+        Logger::log(LogLevel::WARNING, "Malformed GSO packet from peer, dropping");
+        return false;
+    }
+    
+    for (const auto& segment : segments) {
+        if (!write_tun_packet(segment.data(), segment.size(), queue, batch, nullptr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Bridge::write_tun_packet(const char* data, size_t size, size_t queue, IoBatch* batch, GroCoalescer* gro) {
+    if (gro && gro->add(data, size)) {
+        return true;  // Held for merging, written on flush
+    }
+    return write_tun_output(nullptr, data, size, queue, batch);
+}
+
+bool Bridge::write_tun_output(const VnetHdr* hdr, const char* data, size_t size, size_t queue, IoBatch* batch) {
+    if (batch) {
+        return stage_tun_packet(batch, data, size, hdr);
+    }
+    
+    if (hdr) {
+        if (tun_manager->write_gso_packet(*hdr, data, size, queue) <= 0) {
+            Logger::log(LogLevel::WARNING, "Failed to write GSO packet to TUN");
+            return false;
+        }
+        return true;
+    }
+    
+    // Write to TUN as normal IP packet
+    if (tun_manager->write_packet(data, size, queue) <= 0) {
+        Logger::log(LogLevel::WARNING, "Failed to write unwrapped packet to TUN");
+        return false;
+    }
+    return true;
+}
+
+bool Bridge::stage_tun_packet(IoBatch* batch, const char* data, size_t size,
+                              const VnetHdr* hdr) {
+    // Same check write_packet() applies before touching the TUN fd
+    if (!tun_manager->validate_packet(data, size)) {
+        Logger::log(LogLevel::WARNING, "Invalid packet format, refusing to write to TUN");
+        return false;
+    }
+    
+    // Offload mode writes need a header; an empty one marks a plain packet
+    size_t hdr_size = tun_manager->get_vnet_hdr_size();
+    PacketPtr staged = packet_pool.acquire(hdr_size + size, PacketDirection::SOCKET_TO_TUN);
+    if (!staged) {
+        dropped_packets++;
+        return false;
+    }
+    char* out = staged->data();
+    if (hdr_size > 0) {
+        if (hdr) {
+            memcpy(out, hdr, hdr_size);
+        } else {
+            memset(out, 0, hdr_size);
+        }
+    }
+    memcpy(out + hdr_size, data, size);
+    staged->set_size(hdr_size + size);
+    batch->tun_packets.push_back(std::move(staged));
+    return true;
+}
+
+void Bridge::negotiate_offload() {
+    uint8_t peer_caps = crypto_manager ? crypto_manager->get_peer_capabilities() : 0;
+    
+    tx_gso = tun_manager->has_vnet_hdr() && (peer_caps & AUTH_CAP_GSO_RX);
+    rx_gso = (peer_caps & AUTH_CAP_GSO_TX) != 0;
+    
+    if (tx_gso || rx_gso) {
+        Logger::log(LogLevel::INFO, std::string("GSO super-packets: send ") + (tx_gso ? "on" : "off") +
+                   ", receive " + (rx_gso ? "on" : "off"));
+    } else if (tun_manager->has_vnet_hdr()) {
+        Logger::log(LogLevel::INFO, "Peer does not accept GSO super-packets, segmenting locally");
+    }
+}
+
 bool Bridge::handle_authentication() {
     if (auth_in_progress.exchange(true)) {
         Logger::log(LogLevel::DEBUG, "Authentication already in progress, skipping");
@@ -389,7 +1308,7 @@ bool Bridge::handle_authentication() {
     return result;
 }
 
-bool Bridge::handle_auth_packet(const std::vector<uint8_t>& packet) {
+bool Bridge::handle_auth_packet(const PacketBuffer& packet) {
     // Use CryptoManager's proper authentication protocol instead of simple string matching
     if (!crypto_manager) {
         Logger::log(LogLevel::WARNING, "No crypto manager available for authentication");
@@ -397,15 +1316,36 @@ bool Bridge::handle_auth_packet(const std::vector<uint8_t>& packet) {
     }
     
     Logger::log(LogLevel::DEBUG, "Processing auth packet, size: " + std::to_string(packet.size()) + ", type: 0x" + 
-                std::to_string(packet.size() > 0 ? (int)packet[0] : -1));
+                std::to_string(packet.size() > 0 ? (int)(uint8_t)packet.data()[0] : -1));
     
-    if (mode == "server") {
-        // Server handles authentication request from client
-        char response_buffer[512];
-        size_t response_size = sizeof(response_buffer);
-        
-        if (crypto_manager->handle_auth_request(reinterpret_cast<const char*>(packet.data()), 
+    uint8_t packet_type = static_cast<uint8_t>(packet.data()[0]);
+    char response_buffer[512];
+    size_t response_size = sizeof(response_buffer);
+    
+    if (mode == "server" && packet_type == (uint8_t)PacketType::AUTH_REQUEST) {
+        // Server challenges the client's request; the session and the peer
+        // stay as they are, as the request may be a replay from anywhere
+        if (crypto_manager->handle_auth_request(packet.data(), 
+                                               packet.size(), response_buffer, response_size)) {
+            if (socket_manager->send_data_to(response_buffer, response_size, packet.source) > 0) {
+                return true;
+            } else {
+                Logger::log(LogLevel::ERROR, "Failed to send authentication challenge");
+                auth_failures++;
+                return false;
+            }
+        } else {
+            Logger::log(LogLevel::WARNING, "Client authentication failed - PSK mismatch or invalid request");
+            auth_failures++;
+            return false;
+        }
+    } else if (mode == "server" && packet_type == (uint8_t)PacketType::AUTH_CONFIRM) {
+        // Server starts the session once the client has answered the challenge
+        if (crypto_manager->handle_auth_confirm(packet.data(),
                                                packet.size(), response_buffer, response_size)) {
+            negotiate_offload();
+            learn_peer(packet);
+            
             // Send authentication response
             if (socket_manager->send_data(response_buffer, response_size) > 0) {
                 is_authenticated = true;
@@ -418,13 +1358,29 @@ bool Bridge::handle_auth_packet(const std::vector<uint8_t>& packet) {
                 return false;
             }
         } else {
-            Logger::log(LogLevel::WARNING, "Client authentication failed - PSK mismatch or invalid request");
+            Logger::log(LogLevel::WARNING, "Client authentication failed - stale or invalid confirmation");
+            auth_failures++;
+            return false;
+        }
+    } else if (mode == "client" && packet_type == (uint8_t)PacketType::AUTH_RESPONSE) {
+        // Client answers the server's challenge
+        if (crypto_manager->handle_auth_response(packet.data(), packet.size(), response_buffer, response_size)) {
+            if (socket_manager->send_data(response_buffer, response_size) > 0) {
+                return true;
+            } else {
+                Logger::log(LogLevel::ERROR, "Failed to send authentication confirmation");
+                auth_failures++;
+                return false;
+            }
+        } else {
+            Logger::log(LogLevel::WARNING, "Server authentication failed - PSK mismatch or invalid response");
             auth_failures++;
             return false;
         }
     } else if (mode == "client") {
-        // Client handles authentication response from server
-        if (crypto_manager->handle_auth_response(reinterpret_cast<const char*>(packet.data()), packet.size())) {
+        // Client handles authentication result from server
+        if (crypto_manager->handle_auth_success(packet.data(), packet.size())) {
+            negotiate_offload();
             is_authenticated = true;
             auth_in_progress = false;
             Logger::log(LogLevel::INFO, "Client PSK authentication successful - server verified");
@@ -440,6 +1396,14 @@ bool Bridge::handle_auth_packet(const std::vector<uint8_t>& packet) {
     return false;
 }
 
+void Bridge::learn_peer(const PacketBuffer& packet) {
+    // Only packets that passed authentication move the peer: data that passed
+    // the AEAD and the replay window, or the answer to a fresh challenge
+    if (packet.source.sin_family == AF_INET) {
+        socket_manager->update_peer(packet.source);
+    }
+}
+
 bool Bridge::send_auth_request() {
     if (!crypto_manager) {
         Logger::log(LogLevel::ERROR, "No crypto manager available for authentication");
@@ -501,7 +1465,18 @@ void Bridge::print_performance_stats() {
             ", Sent: " + std::to_string(total_packets_sent.load()) +
             ", Received: " + std::to_string(total_packets_received.load()) +
             ", Dropped: " + std::to_string(dropped_packets.load()) +
-            ", Auth Failures: " + std::to_string(auth_failures.load()));
+            ", Auth Failures: " + std::to_string(auth_failures.load()) +
+            ", Replays: " + std::to_string(crypto_manager ? crypto_manager->get_replayed_packets() : 0) +
+            ", Rekeys: " + std::to_string(crypto_manager ? crypto_manager->get_rekeys() : 0));
+        
+        for (auto& worker : workers) {
+            if (worker->encrypt_pool) {
+                print_worker_load("Encrypt", *worker->encrypt_pool);
+            }
+            if (worker->decrypt_pool) {
+                print_worker_load("Decrypt", *worker->decrypt_pool);
+            }
+        }
         
         // Reset counters for next interval
         packets_processed = 0;
@@ -510,6 +1485,17 @@ void Bridge::print_performance_stats() {
     }
 }
 
+void Bridge::print_worker_load(const std::string& name, const CryptoPool& pool) {
+    // Cumulative per-worker counts; a skewed spread shows flows piling up on one worker
+    std::string load;
+    for (size_t i = 0; i < pool.size(); i++) {
+        load += (i > 0 ? ", " : "") + std::to_string(pool.worker_packets(i)) + " pkts/" + 
+                std::to_string(pool.worker_bytes(i)) + " bytes";
+    }
+    Logger::log(LogLevel::INFO, name + " worker load" + (pool.is_flow_steered() ? " (flow steered)" : "") + 
+               ": " + load);
+}
+
 bool Bridge::wait_for_connection(int timeout_seconds) {
     auto start = std::chrono::steady_clock::now();
     while (!is_authenticated && !should_stop) {
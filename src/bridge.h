@@ -5,19 +5,50 @@
 #include "tun_manager.h"
 #include "socket_manager.h"
 #include "crypto_manager.h"
+#include "frame_buffer.h"
+#include "event_loop.h"
+#include "uring_engine.h"
+#include "gro_coalescer.h"
+#include "tx_batcher.h"
+#include "packet_pool.h"
+#include "packet_ring.h"
+#include "crypto_pool.h"
+#include "flow_hash.h"
+#include "thread_placement.h"
 #include <thread>
 #include <mutex>
-#include <condition_variable>
-#include <queue>
 #include <atomic>
 #include <memory>
 
-// Packet structure for queue
-struct Packet {
-    std::vector<uint8_t> data;
-    enum Type { TUN_TO_SOCKET, SOCKET_TO_TUN } type;
+// TUN writes staged by the decrypt pipeline during one batch, flushed with one io_uring submission
+struct IoBatch {
+    std::vector<PacketPtr> tun_packets;
     
-    Packet(const std::vector<uint8_t>& d, Type t) : data(d), type(t) {}
+    bool empty() const { return tun_packets.empty(); }
+    void clear() { tun_packets.clear(); }
+};
+
+// Per-TUN-queue pipelines, one per direction, sharing nothing but the TUN fd:
+//   TUN reader -> tun_ring -> encrypt thread [-> crypto workers] -> socket
+//   socket reader -> socket_ring -> decrypt thread [-> crypto workers] -> TUN
+struct TunWorker {
+    size_t queue_index;
+    std::thread reader_thread;
+    std::thread encrypt_thread;
+    std::thread decrypt_thread;
+    
+    SpscRing<PacketPtr> tun_ring;     // TUN reader -> encrypt thread
+    SpscRing<PacketPtr> socket_ring;  // Socket reader -> decrypt thread
+    RingWaiter encrypt_waiter;        // Parks the encrypt thread when tun_ring is empty
+    RingWaiter decrypt_waiter;        // Parks the decrypt thread when socket_ring is empty
+    
+    // Crypto workers of each pipeline (none: crypto runs on the pipeline thread)
+    std::unique_ptr<CryptoPool> encrypt_pool;
+    std::unique_ptr<CryptoPool> decrypt_pool;
+    
+    EventLoop loop;  // Reactor for this queue's TUN fd
+    
+    explicit TunWorker(size_t index) : queue_index(index) {}
 };
 
 class Bridge {
@@ -27,21 +58,27 @@ private:
     SocketManager* socket_manager;
     CryptoManager* crypto_manager;
     
+    // Packet buffers for both directions; outlives the queues below
+    PacketPool packet_pool;
+    
     // Threading
-    std::thread tun_reader_thread;
+    std::vector<std::unique_ptr<TunWorker>> workers;  // One pipeline per TUN queue
     std::thread socket_reader_thread;
-    std::thread packet_processor_thread;
     std::thread heartbeat_thread;
-    
-    // Packet queues with locks
-    std::queue<std::shared_ptr<Packet>> packet_queue;
-    std::mutex queue_mutex;
-    std::condition_variable queue_cv;
+    EventLoop socket_loop;  // Reactor for the socket reader
+    IoEngine io_engine;     // epoll or io_uring data path
+    TxFlushPolicy tx_policy;  // When batched socket frames are sent
+    size_t crypto_workers;    // Crypto threads per pipeline (0: crypto runs on the pipeline thread)
+    FlowHasher flow_hasher;   // Steers TUN packets to encrypt workers by flow
+    ThreadPlacement placement;  // CPU pinning per thread role
+    long spin_usec;             // Latency mode: busy-poll budget before blocking (0: off)
     
     // Authentication state
     std::atomic<bool> is_authenticated;
     std::atomic<bool> should_stop;
     std::atomic<bool> auth_in_progress;
+    std::atomic<bool> tx_gso;  // Send GSO super-packets as-is (peer accepts them)
+    std::atomic<bool> rx_gso;  // Peer payloads start with a virtio_net_hdr
     std::atomic<uint64_t> packets_processed;
     std::atomic<uint64_t> bytes_transferred;
     
@@ -61,24 +98,77 @@ private:
     int port;
     
     // Threading functions
-    void tun_reader_loop();
+    void tun_reader_loop(TunWorker* worker);
     void socket_reader_loop();
-    void packet_processor_loop();
+    void encrypt_loop(TunWorker* worker);
+    void decrypt_loop(TunWorker* worker);
     void heartbeat_loop();
     
-    // Packet processing
-    bool process_tun_packet(const std::vector<uint8_t>& packet);
-    bool process_socket_packet(const std::vector<uint8_t>& packet);
+    // Hand a packet to the worker thread for its direction (dropped if the ring
+    // is full); without notify the caller wakes that thread once per batch
+    bool enqueue_packet(TunWorker* worker, PacketPtr packet, bool notify = true);
+    
+    // io_uring variants of the loops (return false if no ring could be set up)
+    bool tun_reader_loop_uring(TunWorker* worker, int tun_fd);
+    bool socket_reader_loop_uring(FrameBuffer& frames, int socket_fd);
+    void flush_io_batch(UringEngine& ring, IoBatch& batch, size_t queue);
+    
+    // Send the frames staged for the socket
+    void flush_tx(TxBatcher& tx);
+    
+    // Drain a non-blocking fd until EAGAIN
+    void drain_tun_queue(TunWorker* worker);
+    bool drain_socket(FrameBuffer& frames);
+    bool drain_datagrams(DatagramBatch& datagrams);
+    
+    // Slice complete frames out of the socket stream and queue them
+    bool dispatch_socket_frames(FrameBuffer& frames);
+    
+    // Packet processing (TUN packets are collected in burst for wrapping; with
+    // a batch, TUN output is staged instead of written immediately)
+    bool process_tun_packet(PacketPtr packet, std::vector<CryptoJob>& burst, CryptoPool* crypto_pool = nullptr);
+    bool process_socket_packet(PacketBuffer& packet, size_t queue = 0, IoBatch* batch = nullptr,
+                               GroCoalescer* gro = nullptr);
+    bool stage_tun_packet(IoBatch* batch, const char* data, size_t size,
+                          const VnetHdr* hdr = nullptr);
+    
+    // Add one payload to the burst to wrap, or hand it to the crypto pool
+    bool forward_to_socket(PacketPtr packet, std::vector<CryptoJob>& burst, CryptoPool* crypto_pool);
+    
+    // In-place crypto, safe to run on crypto pool workers; bursts set each job's ok.
+    // Wrapped packets carry the pipeline's queue as their lane.
+    void wrap_jobs(CryptoJob* jobs, size_t count, size_t queue);
+    void unwrap_jobs(CryptoJob* jobs, size_t count);
+    bool unwrap_packet(PacketBuffer& packet);
+    
+    // Socket packets: auth messages are handled on the first pipeline's thread, in order
+    bool is_auth_packet(const PacketBuffer& packet) const;
+    
+    // Pass one unwrapped packet on: keepalives end here, the rest goes to TUN
+    bool deliver_unwrapped(PacketBuffer& packet, size_t queue, IoBatch* batch, GroCoalescer* gro);
+    
+    // Write one decrypted payload to TUN, segmenting GSO packets if needed
+    // and merging TCP segments when a coalescer is given
+    bool deliver_to_tun(const char* data, size_t size, size_t queue, IoBatch* batch, GroCoalescer* gro);
+    bool write_tun_packet(const char* data, size_t size, size_t queue, IoBatch* batch, GroCoalescer* gro);
+    bool write_tun_output(const VnetHdr* hdr, const char* data, size_t size, size_t queue, IoBatch* batch);
+    
+    // Decide GSO pass-through from the capabilities exchanged during auth
+    void negotiate_offload();
     
     // Authentication
     bool handle_authentication();
-    bool handle_auth_packet(const std::vector<uint8_t>& packet);
+    bool handle_auth_packet(const PacketBuffer& packet);
+    
+    // UDP: follow the peer to the address its authenticated packets come from
+    void learn_peer(const PacketBuffer& packet);
     bool send_auth_request();
     bool send_auth_response();
     
     // Performance monitoring
     void update_statistics(size_t bytes, bool sent = true);
     void print_performance_stats();
+    void print_worker_load(const std::string& name, const CryptoPool& pool);
     void increment_dropped_packets() { dropped_packets++; }
     void increment_auth_failures() { auth_failures++; }
 
@@ -88,6 +178,12 @@ public:
     
     // Control functions
     bool initialize(const std::string& mode, const std::string& remote_ip = "", int port = 51860);
+    void set_io_engine(IoEngine engine) { io_engine = engine; }
+    void set_tx_flush_policy(const TxFlushPolicy& policy) { tx_policy = policy; }
+    void set_crypto_workers(size_t count) { crypto_workers = count; }
+    void set_flow_steering(FlowHashMode mode) { flow_hasher.set_mode(mode); }
+    void set_thread_placement(const ThreadPlacement& thread_placement) { placement = thread_placement; }
+    void set_latency_mode(long spin_budget_usec) { spin_usec = spin_budget_usec; }
     bool start();
     void stop();
     
@@ -2,19 +2,73 @@
 #include <openssl/kdf.h>
 #include <openssl/hmac.h>
 #include <cstring>
+#include <endian.h>
 
-CryptoManager::CryptoManager() : initialized(false), authenticated(false), gen(rd()) {
+// Unique per key install across managers, so a thread's contexts know when to rekey
+static std::atomic<uint64_t> key_epoch_counter(0);
+
+// One thread's data path contexts. Each is keyed once per key (the expensive
+// key schedule) and only gets a new nonce per packet. Both receive slots have
+// their own context, as packets under either key arrive during a switch.
+struct ThreadCipher {
+    EVP_CIPHER_CTX* seal_ctx;
+    EVP_CIPHER_CTX* open_ctx[2];
+    uint64_t seal_epoch;  // Key the context holds, 0 for none
+    uint64_t open_epoch[2];
+    uint64_t open_generation[2];
+    
+    ThreadCipher() : seal_ctx(EVP_CIPHER_CTX_new()), open_ctx{EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_new()},
+                     seal_epoch(0), open_epoch{0, 0}, open_generation{0, 0} {}
+    ~ThreadCipher() {
+        EVP_CIPHER_CTX_free(seal_ctx);
+        EVP_CIPHER_CTX_free(open_ctx[0]);
+        EVP_CIPHER_CTX_free(open_ctx[1]);
+    }
+};
+
+static thread_local ThreadCipher thread_cipher;
+
+CryptoManager::CryptoManager() : initialized(false), authenticated(false),
+                                 local_capabilities(0), peer_capabilities(0), handshake_state(HandshakeState::IDLE),
+                                 handshake_capabilities(0), handshake_suite(CipherSuite::AES_256_GCM),
+                                 preferred_suite(CipherSuite::AES_256_GCM), preference_margin(0), suite_configured(false),
+                                 cipher_suite(CipherSuite::AES_256_GCM), data_cipher(EVP_aes_256_gcm()),
+                                 send_generation(0), receive_generation(0),
+                                 rekey_interval_seconds(REKEY_INTERVAL_SECONDS), rekey_packets(REKEY_PACKETS),
+                                 send_prepared(0), receive_prepared(0), peer_prepared(0), receive_seen(0), send_switch_counter(0),
+                                 rekeys(0), local_nonce_prefix(0), peer_nonce_prefix(0), send_counters(new LaneCounter[CRYPTO_MAX_LANES]),
+                                 replay_windows(new ReplayWindow[CRYPTO_MAX_LANES]), session_id(0),
+                                 replayed_packets(0), gen(rd()) {
+    for (size_t lane = 0; lane < CRYPTO_MAX_LANES; lane++) {
+        send_counters[lane].value = 0;
+        replay_windows[lane].top = 0;
+        memset(replay_windows[lane].bitmap, 0, sizeof(replay_windows[lane].bitmap));
+    }
+    memset(handshake_salt, 0, sizeof(handshake_salt));
     memset(aes_key, 0, sizeof(aes_key));
-    memset(hmac_key, 0, sizeof(hmac_key));
+    memset(handshake_data_key, 0, sizeof(handshake_data_key));
+    memset(handshake_auth_key, 0, sizeof(handshake_auth_key));
+    for (KeySlot* slots : {send_keys, receive_keys}) {
+        for (size_t i = 0; i < 2; i++) {
+            memset(slots[i].key, 0, AES_KEY_SIZE);
+            slots[i].generation = 0;
+            slots[i].epoch = 0;
+        }
+    }
 }
 
 CryptoManager::~CryptoManager() {
     // Clear sensitive data
     memset(aes_key, 0, sizeof(aes_key));
-    memset(hmac_key, 0, sizeof(hmac_key));
+    memset(handshake_data_key, 0, sizeof(handshake_data_key));
+    memset(handshake_auth_key, 0, sizeof(handshake_auth_key));
+    for (KeySlot* slots : {send_keys, receive_keys}) {
+        memset(slots[0].key, 0, AES_KEY_SIZE);
+        memset(slots[1].key, 0, AES_KEY_SIZE);
+    }
 }
 
-bool CryptoManager::initialize(const std::string& psk) {
+bool CryptoManager::initialize(const std::string& psk, CipherSuite suite) {
     if (psk.length() < 16) {
         Logger::log(LogLevel::ERROR, "Pre-shared key too short (minimum 16 characters)");
         return false;
@@ -24,6 +78,32 @@ bool CryptoManager::initialize(const std::string& psk) {
     initialized = true;
     authenticated = false;
     
+    if (suite != CipherSuite::AUTO) {
+        // Configured: insist on it as strongly as the handshake allows
+        preferred_suite = suite;
+        preference_margin = SUITE_MARGIN_CONFIGURED;
+        suite_configured = true;
+        Logger::log(LogLevel::INFO, std::string("Cipher suite preference: ") + suite_name(suite) + " (configured)");
+    } else {
+        // No AES instructions makes GCM several times slower than ChaCha20
+        double aes_rate = benchmark_suite(CipherSuite::AES_256_GCM);
+        double chacha_rate = benchmark_suite(CipherSuite::CHACHA20_POLY1305);
+        bool aes_faster = aes_rate >= chacha_rate;
+        double fast = aes_faster ? aes_rate : chacha_rate;
+        double slow = aes_faster ? chacha_rate : aes_rate;
+        
+        preferred_suite = aes_faster ? CipherSuite::AES_256_GCM : CipherSuite::CHACHA20_POLY1305;
+        preference_margin = slow > 0 ? static_cast<uint8_t>(std::min(SUITE_MARGIN_CONFIGURED - 1.0, (fast / slow - 1) * 100))
+                                     : SUITE_MARGIN_CONFIGURED - 1;
+        suite_configured = false;
+        
+        Logger::log(LogLevel::INFO, "Cipher benchmark: " + std::string(suite_name(CipherSuite::AES_256_GCM)) + " " +
+                   std::to_string(static_cast<long>(aes_rate / 1e6)) + " MB/s, " +
+                   suite_name(CipherSuite::CHACHA20_POLY1305) + " " +
+                   std::to_string(static_cast<long>(chacha_rate / 1e6)) + " MB/s, preferring " +
+                   suite_name(preferred_suite));
+    }
+    
     Logger::log(LogLevel::INFO, "Crypto manager initialized with PSK");
     return true;
 }
@@ -36,20 +116,23 @@ bool CryptoManager::derive_keys(const uint8_t* salt, size_t salt_len) {
     
     // Derive AES key
     if (!pbkdf2((const uint8_t*)pre_shared_key.c_str(), pre_shared_key.length(),
-               salt, salt_len, 10000, aes_key, AES_KEY_SIZE)) {
+               salt, salt_len, 10000, handshake_data_key, AES_KEY_SIZE)) {
         Logger::log(LogLevel::ERROR, "Failed to derive AES key");
         return false;
     }
     
     // Derive HMAC key (using different salt)
-    uint8_t hmac_salt[SALT_SIZE];
+    uint8_t hmac_salt[HANDSHAKE_SALT_SIZE];
+    if (salt_len > sizeof(hmac_salt)) {
+        return false;
+    }
     memcpy(hmac_salt, salt, salt_len);
     for (size_t i = 0; i < salt_len; i++) {
         hmac_salt[i] ^= 0xAA; // XOR with pattern to create different salt
     }
     
     if (!pbkdf2((const uint8_t*)pre_shared_key.c_str(), pre_shared_key.length(),
-               hmac_salt, salt_len, 10000, hmac_key, AES_KEY_SIZE)) {
+               hmac_salt, salt_len, 10000, handshake_auth_key, AES_KEY_SIZE)) {
         Logger::log(LogLevel::ERROR, "Failed to derive HMAC key");
         return false;
     }
@@ -69,10 +152,13 @@ bool CryptoManager::create_auth_request(char* buffer, size_t& buffer_size) {
         return false;
     }
     
+    if (!fill_auth_header(buffer, PacketType::AUTH_REQUEST, SALT_SIZE)) {
+        return false;
+    }
     EncryptedHeader* header = (EncryptedHeader*)buffer;
-    header->packet_type = (uint8_t)PacketType::AUTH_REQUEST;
-    memset(header->reserved, 0, sizeof(header->reserved));
-    header->data_length = htonl(SALT_SIZE);
+    header->reserved[0] = local_capabilities;
+    header->reserved[1] = (uint8_t)preferred_suite;
+    header->reserved[2] = preference_margin;
     
     // Generate salt for key derivation
     uint8_t* salt = (uint8_t*)(buffer + sizeof(EncryptedHeader));
@@ -81,20 +167,18 @@ bool CryptoManager::create_auth_request(char* buffer, size_t& buffer_size) {
         return false;
     }
     
-    // Generate IV 
-    if (!generate_iv(header->iv)) {
-        return false;
-    }
-    
     // Create HMAC using PSK directly (before key derivation)
     // This allows server to verify without deriving keys first
-    if (!compute_hmac(salt, SALT_SIZE, (const uint8_t*)pre_shared_key.c_str(), pre_shared_key.length(), header->hmac)) {
+    if (!compute_auth_tag(header, salt, SALT_SIZE, (const uint8_t*)pre_shared_key.c_str(),
+                          pre_shared_key.length(), header->tag)) {
         return false;
     }
     
-    // Now derive keys using this salt for subsequent data encryption
-    if (!derive_keys(salt, SALT_SIZE)) {
-        return false;
+    // Keys wait for the server's nonce; a later request supersedes this one
+    {
+        std::lock_guard<std::mutex> lock(handshake_mutex);
+        memcpy(handshake_salt, salt, SALT_SIZE);
+        handshake_state = HandshakeState::REQUESTED;
     }
     
     buffer_size = required_size;
@@ -116,228 +200,354 @@ bool CryptoManager::handle_auth_request(const char* buffer, size_t buffer_size,
     const uint8_t* salt = (const uint8_t*)(buffer + sizeof(EncryptedHeader));
     
     // Verify HMAC using PSK directly (before key derivation)
-    uint8_t expected_hmac[HMAC_SIZE];
-    if (!compute_hmac(salt, SALT_SIZE, (const uint8_t*)pre_shared_key.c_str(), pre_shared_key.length(), expected_hmac)) {
+    uint8_t expected_tag[AUTH_TAG_SIZE];
+    if (!compute_auth_tag(header, salt, SALT_SIZE, (const uint8_t*)pre_shared_key.c_str(),
+                          pre_shared_key.length(), expected_tag)) {
         return false;
     }
     
-    if (!constant_time_compare(header->hmac, expected_hmac, HMAC_SIZE)) {
+    if (!constant_time_compare(header->tag, expected_tag, AUTH_TAG_SIZE)) {
         Logger::log(LogLevel::WARNING, "Authentication failed: PSK HMAC mismatch");
         return false;
     }
     
-    // PSK verified! Now derive keys using received salt
-    if (!derive_keys(salt, SALT_SIZE)) {
-        return false;
+    // Take the client's suite if it gains more there than ours does here
+    // (a configured suite on either side outweighs any benchmark)
+    CipherSuite suite = preferred_suite;
+    CipherSuite peer_suite = (CipherSuite)header->reserved[1];
+    if (peer_suite != suite && suite_cipher(peer_suite)) {
+        if (!suite_configured && header->reserved[2] > preference_margin) {
+            suite = peer_suite;
+        } else if (suite_configured && header->reserved[2] == SUITE_MARGIN_CONFIGURED) {
+            Logger::log(LogLevel::WARNING, std::string("Client is configured for ") + suite_name(peer_suite) +
+                       ", keeping the configured " + suite_name(suite) + "; the client will refuse it");
+        }
     }
     
-    // Create success response
-    size_t required_size = sizeof(EncryptedHeader);
+    // The request may be a replay: challenge it with a fresh nonce and leave
+    // the session alone until the client answers
+    size_t required_size = sizeof(EncryptedHeader) + HANDSHAKE_SALT_SIZE;
     if (response_size < required_size) {
         response_size = required_size;
         return false;
     }
     
+    if (!fill_auth_header(response, PacketType::AUTH_RESPONSE, HANDSHAKE_SALT_SIZE)) {
+        return false;
+    }
     EncryptedHeader* resp_header = (EncryptedHeader*)response;
-    resp_header->packet_type = (uint8_t)PacketType::AUTH_SUCCESS;
-    memset(resp_header->reserved, 0, sizeof(resp_header->reserved));
-    resp_header->data_length = htonl(0);
+    resp_header->reserved[0] = local_capabilities;
+    resp_header->reserved[1] = (uint8_t)suite;
     
-    if (!generate_iv(resp_header->iv)) {
+    uint8_t* challenge = (uint8_t*)(response + sizeof(EncryptedHeader));
+    memcpy(challenge, salt, SALT_SIZE);
+    if (!RAND_bytes(challenge + SALT_SIZE, SALT_SIZE)) {
+        Logger::log(LogLevel::ERROR, "Failed to generate random nonce");
         return false;
     }
     
-    // HMAC of empty data for success message using derived HMAC key
-    if (!compute_hmac(nullptr, 0, hmac_key, resp_header->hmac)) {
+    if (!compute_auth_tag(resp_header, challenge, HANDSHAKE_SALT_SIZE, (const uint8_t*)pre_shared_key.c_str(),
+                          pre_shared_key.length(), resp_header->tag)) {
         return false;
     }
     
-    authenticated = true;
-    auth_time = std::chrono::steady_clock::now();
-    response_size = required_size;
+    {
+        std::lock_guard<std::mutex> lock(handshake_mutex);
+        memcpy(handshake_salt, challenge, HANDSHAKE_SALT_SIZE);
+        handshake_capabilities = header->reserved[0];
+        handshake_suite = suite;
+        handshake_state = HandshakeState::CHALLENGED;
+    }
     
-    Logger::log(LogLevel::INFO, "PSK authentication successful (server) - keys synchronized");
+    response_size = required_size;
+    Logger::log(LogLevel::DEBUG, "PSK verified, challenging the client with a fresh nonce");
     return true;
 }
 
-bool CryptoManager::handle_auth_response(const char* buffer, size_t buffer_size) {
-    if (buffer_size < sizeof(EncryptedHeader)) {
+bool CryptoManager::handle_auth_response(const char* buffer, size_t buffer_size,
+                                        char* confirm, size_t& confirm_size) {
+    if (buffer_size < sizeof(EncryptedHeader) + HANDSHAKE_SALT_SIZE) {
         return false;
     }
     
     const EncryptedHeader* header = (const EncryptedHeader*)buffer;
-    if (header->packet_type != (uint8_t)PacketType::AUTH_SUCCESS) {
-        Logger::log(LogLevel::WARNING, "Authentication failed");
+    if (header->packet_type != (uint8_t)PacketType::AUTH_RESPONSE) {
         return false;
     }
     
-    // Verify HMAC
-    uint8_t expected_hmac[HMAC_SIZE];
-    if (!compute_hmac(nullptr, 0, hmac_key, expected_hmac)) {
+    const uint8_t* challenge = (const uint8_t*)(buffer + sizeof(EncryptedHeader));
+    
+    uint8_t expected_tag[AUTH_TAG_SIZE];
+    if (!compute_auth_tag(header, challenge, HANDSHAKE_SALT_SIZE, (const uint8_t*)pre_shared_key.c_str(),
+                          pre_shared_key.length(), expected_tag)) {
         return false;
     }
     
-    if (!constant_time_compare(header->hmac, expected_hmac, HMAC_SIZE)) {
-        Logger::log(LogLevel::WARNING, "Authentication failed: HMAC mismatch in response");
+    if (!constant_time_compare(header->tag, expected_tag, AUTH_TAG_SIZE)) {
+        Logger::log(LogLevel::WARNING, "Authentication failed: PSK HMAC mismatch in response");
         return false;
     }
     
-    authenticated = true;
-    auth_time = std::chrono::steady_clock::now();
+    CipherSuite suite = (CipherSuite)header->reserved[1];
+    if (!suite_cipher(suite)) {
+        Logger::log(LogLevel::WARNING, "Authentication failed: unknown cipher suite " +
+                   std::to_string(header->reserved[1]));
+        return false;
+    }
+    if (suite_configured && suite != preferred_suite) {
+        Logger::log(LogLevel::ERROR, std::string("Authentication failed: server requires ") + suite_name(suite) +
+                   " but --cipher " + suite_name(preferred_suite) + " is configured");
+        return false;
+    }
     
-    Logger::log(LogLevel::INFO, "Authentication successful (client)");
-    return true;
-}
-
-bool CryptoManager::encrypt_packet(const char* plaintext, size_t plaintext_size,
-                                  char* ciphertext, size_t& ciphertext_size) {
-    if (!authenticated) {
+    size_t required_size = sizeof(EncryptedHeader);
+    if (confirm_size < required_size) {
+        confirm_size = required_size;
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(handshake_mutex);
+    
+    // Only an answer to our latest request: replayed responses carry an old salt
+    if (handshake_state != HandshakeState::REQUESTED ||
+        !constant_time_compare(challenge, handshake_salt, SALT_SIZE)) {
+        Logger::log(LogLevel::DEBUG, "Ignoring authentication response to an earlier request");
         return false;
     }
     
-    uint8_t iv[AES_IV_SIZE];
-    if (!generate_iv(iv)) {
+    if (!derive_keys(challenge, HANDSHAKE_SALT_SIZE)) {
         return false;
     }
     
-    return encrypt_packet_with_iv(plaintext, plaintext_size, ciphertext, ciphertext_size, iv);
+    if (!fill_auth_header(confirm, PacketType::AUTH_CONFIRM, 0) ||
+        !compute_auth_tag((const EncryptedHeader*)confirm, challenge, HANDSHAKE_SALT_SIZE,
+                          (const uint8_t*)pre_shared_key.c_str(), pre_shared_key.length(),
+                          ((EncryptedHeader*)confirm)->tag)) {
+        return false;
+    }
+    
+    memcpy(handshake_salt, challenge, HANDSHAKE_SALT_SIZE);
+    handshake_capabilities = header->reserved[0];
+    handshake_suite = suite;
+    handshake_state = HandshakeState::CONFIRMED;
+    
+    confirm_size = required_size;
+    Logger::log(LogLevel::DEBUG, "Server challenge answered, keys derived");
+    return true;
 }
 
-bool CryptoManager::encrypt_packet_with_iv(const char* plaintext, size_t plaintext_size,
-                                          char* ciphertext, size_t& ciphertext_size, const uint8_t* iv) {
-    if (!authenticated) {
+bool CryptoManager::handle_auth_confirm(const char* buffer, size_t buffer_size,
+                                       char* response, size_t& response_size) {
+    if (buffer_size < sizeof(EncryptedHeader)) {
         return false;
     }
     
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) {
+    const EncryptedHeader* header = (const EncryptedHeader*)buffer;
+    if (header->packet_type != (uint8_t)PacketType::AUTH_CONFIRM) {
         return false;
     }
     
-    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, aes_key, iv) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    size_t required_size = sizeof(EncryptedHeader);
+    if (response_size < required_size) {
+        response_size = required_size;
         return false;
     }
     
-    int len;
-    int ciphertext_len = 0;
+    std::lock_guard<std::mutex> lock(handshake_mutex);
+    if (handshake_state != HandshakeState::CHALLENGED) {
+        Logger::log(LogLevel::DEBUG, "Ignoring authentication confirmation without a challenge");
+        return false;
+    }
     
-    // Encrypt the data (don't prepend IV, caller handles it)
-    if (EVP_EncryptUpdate(ctx, (unsigned char*)ciphertext, &len,
-                         (const unsigned char*)plaintext, plaintext_size) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    // Covers our nonce, so only the answer to this challenge verifies
+    uint8_t expected_tag[AUTH_TAG_SIZE];
+    if (!compute_auth_tag(header, handshake_salt, HANDSHAKE_SALT_SIZE, (const uint8_t*)pre_shared_key.c_str(),
+                          pre_shared_key.length(), expected_tag)) {
         return false;
     }
-    ciphertext_len = len;
     
-    if (EVP_EncryptFinal_ex(ctx, (unsigned char*)ciphertext + len, &len) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    if (!constant_time_compare(header->tag, expected_tag, AUTH_TAG_SIZE)) {
+        Logger::log(LogLevel::WARNING, "Authentication failed: PSK HMAC mismatch in confirmation");
         return false;
     }
-    ciphertext_len += len;
     
-    EVP_CIPHER_CTX_free(ctx);
-    ciphertext_size = ciphertext_len;
+    // One session per challenge
+    handshake_state = HandshakeState::IDLE;
     
-    return true;
-}
-
-bool CryptoManager::decrypt_packet(const char* ciphertext, size_t ciphertext_size,
-                                  char* plaintext, size_t& plaintext_size) {
-    if (!authenticated || ciphertext_size < AES_IV_SIZE) {
+    if (!derive_keys(handshake_salt, HANDSHAKE_SALT_SIZE)) {
+        return false;
+    }
+    
+    if (!fill_auth_header(response, PacketType::AUTH_SUCCESS, 0)) {
         return false;
     }
     
-    const uint8_t* iv = (const uint8_t*)ciphertext;
-    const uint8_t* encrypted_data = (const uint8_t*)ciphertext + AES_IV_SIZE;
-    size_t encrypted_size = ciphertext_size - AES_IV_SIZE;
+    // HMAC of the handshake for success message using derived HMAC key
+    EncryptedHeader* resp_header = (EncryptedHeader*)response;
+    if (!compute_auth_tag(resp_header, handshake_salt, HANDSHAKE_SALT_SIZE, handshake_auth_key, AES_KEY_SIZE,
+                          resp_header->tag)) {
+        return false;
+    }
     
-    return decrypt_packet_with_iv((const char*)encrypted_data, encrypted_size, plaintext, plaintext_size, iv);
+    start_session(false);
+    peer_capabilities = handshake_capabilities;
+    select_suite(handshake_suite);
+    authenticated = true;
+    response_size = required_size;
+    
+    Logger::log(LogLevel::INFO, "PSK authentication successful (server) - keys synchronized");
+    return true;
 }
 
-bool CryptoManager::decrypt_packet_with_iv(const char* ciphertext, size_t ciphertext_size,
-                                          char* plaintext, size_t& plaintext_size, const uint8_t* iv) {
-    if (!authenticated) {
+bool CryptoManager::handle_auth_success(const char* buffer, size_t buffer_size) {
+    if (buffer_size < sizeof(EncryptedHeader)) {
         return false;
     }
     
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) {
+    const EncryptedHeader* header = (const EncryptedHeader*)buffer;
+    if (header->packet_type != (uint8_t)PacketType::AUTH_SUCCESS) {
+        Logger::log(LogLevel::WARNING, "Authentication failed");
         return false;
     }
     
-    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, aes_key, iv) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    std::lock_guard<std::mutex> lock(handshake_mutex);
+    if (handshake_state != HandshakeState::CONFIRMED) {
+        Logger::log(LogLevel::DEBUG, "Ignoring authentication success without a confirmation");
         return false;
     }
     
-    int len;
-    int plaintext_len = 0;
-    
-    if (EVP_DecryptUpdate(ctx, (unsigned char*)plaintext, &len,
-                         (const unsigned char*)ciphertext, ciphertext_size) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    // Verify HMAC
+    uint8_t expected_tag[AUTH_TAG_SIZE];
+    if (!compute_auth_tag(header, handshake_salt, HANDSHAKE_SALT_SIZE, handshake_auth_key, AES_KEY_SIZE, expected_tag)) {
         return false;
     }
-    plaintext_len = len;
     
-    if (EVP_DecryptFinal_ex(ctx, (unsigned char*)plaintext + len, &len) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    if (!constant_time_compare(header->tag, expected_tag, AUTH_TAG_SIZE)) {
+        Logger::log(LogLevel::WARNING, "Authentication failed: HMAC mismatch in response");
         return false;
     }
-    plaintext_len += len;
     
-    EVP_CIPHER_CTX_free(ctx);
-    plaintext_size = plaintext_len;
+    handshake_state = HandshakeState::IDLE;
+    start_session(true);
+    peer_capabilities = handshake_capabilities;
+    select_suite(handshake_suite);
+    authenticated = true;
     
+    Logger::log(LogLevel::INFO, "Authentication successful (client)");
     return true;
 }
 
-bool CryptoManager::wrap_data_packet(const char* data, size_t data_size,
-                                    char* wrapped, size_t& wrapped_size) {
-    if (!authenticated) {
+bool CryptoManager::load_key(EVP_CIPHER_CTX* ctx, KeySlot& slot, bool encrypt, uint64_t& epoch,
+                             uint64_t& generation) {
+    std::lock_guard<std::mutex> lock(key_mutex);
+    epoch = slot.epoch.load(std::memory_order_relaxed);
+    generation = slot.generation;
+    int result = encrypt ? EVP_EncryptInit_ex(ctx, data_cipher, NULL, slot.key, NULL)
+                         : EVP_DecryptInit_ex(ctx, data_cipher, NULL, slot.key, NULL);
+    return result == 1;
+}
+
+bool CryptoManager::aead_seal(const EncryptedHeader* header, const char* plaintext, size_t size,
+                              char* ciphertext, uint8_t* tag) {
+    EVP_CIPHER_CTX* ctx = thread_cipher.seal_ctx;
+    KeySlot& slot = send_keys[header->reserved[0] & DATA_FLAG_KEY_ID];
+    if (!ctx) {
         return false;
     }
+    if (thread_cipher.seal_epoch != slot.epoch.load(std::memory_order_acquire)) {
+        uint64_t generation;
+        if (!load_key(ctx, slot, true, thread_cipher.seal_epoch, generation)) {
+            thread_cipher.seal_epoch = 0;
+            return false;
+        }
+    }
     
-    size_t encrypted_size = data_size + AES_BLOCK_SIZE; // Extra space for padding
-    size_t required_size = sizeof(EncryptedHeader) + encrypted_size;
-    
-    if (wrapped_size < required_size) {
-        wrapped_size = required_size;
+    // Only the nonce is new per packet (12 bytes, the default for both suites);
+    // the header up to the tag is the AAD
+    int len;
+    return EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, header->nonce) == 1 &&
+           EVP_EncryptUpdate(ctx, NULL, &len, (const unsigned char*)header, AEAD_AAD_SIZE) == 1 &&
+           EVP_EncryptUpdate(ctx, (unsigned char*)ciphertext, &len, (const unsigned char*)plaintext, size) == 1 &&
+           EVP_EncryptFinal_ex(ctx, (unsigned char*)ciphertext + len, &len) == 1 &&
+           EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag) == 1;
+}
+
+bool CryptoManager::aead_open(const EncryptedHeader* header, const char* ciphertext, size_t size,
+                              char* plaintext) {
+    size_t key_id = header->reserved[0] & DATA_FLAG_KEY_ID;
+    EVP_CIPHER_CTX* ctx = thread_cipher.open_ctx[key_id];
+    KeySlot& slot = receive_keys[key_id];
+    if (!ctx) {
         return false;
     }
+    if (thread_cipher.open_epoch[key_id] != slot.epoch.load(std::memory_order_acquire)) {
+        if (!load_key(ctx, slot, false, thread_cipher.open_epoch[key_id], thread_cipher.open_generation[key_id])) {
+            thread_cipher.open_epoch[key_id] = 0;
+            return false;
+        }
+    }
     
-    EncryptedHeader* header = (EncryptedHeader*)wrapped;
-    header->packet_type = (uint8_t)PacketType::DATA_PACKET;
-    memset(header->reserved, 0, sizeof(header->reserved));
-    
-    // Generate IV for this packet
-    if (!generate_iv(header->iv)) {
+    // Final fails unless the tag matches header and ciphertext
+    int len;
+    if (EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, header->nonce) != 1 ||
+        EVP_DecryptUpdate(ctx, NULL, &len, (const unsigned char*)header, AEAD_AAD_SIZE) != 1 ||
+        EVP_DecryptUpdate(ctx, (unsigned char*)plaintext, &len, (const unsigned char*)ciphertext, size) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, const_cast<uint8_t*>(header->tag)) != 1 ||
+        EVP_DecryptFinal_ex(ctx, (unsigned char*)plaintext + len, &len) != 1) {
         return false;
     }
     
-    // Encrypt the data using the header IV
-    char* encrypted_data = wrapped + sizeof(EncryptedHeader);
-    size_t actual_encrypted_size = encrypted_size;
-    if (!encrypt_packet_with_iv(data, data_size, encrypted_data, actual_encrypted_size, header->iv)) {
-        return false;
+    // An authentic packet under a newer key means the peer has switched
+    uint64_t generation = thread_cipher.open_generation[key_id];
+    uint64_t newest = receive_generation.load(std::memory_order_relaxed);
+    while (generation > newest &&
+           !receive_generation.compare_exchange_weak(newest, generation, std::memory_order_release)) {
     }
     
-    header->data_length = htonl(actual_encrypted_size);
+    // Authentic, so the peer's report of its next key can be trusted
+    if (peer_prepared.load(std::memory_order_relaxed) != header->reserved[2]) {
+        peer_prepared.store(header->reserved[2], std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool CryptoManager::seal_frame(char* frame, const char* data, size_t data_size, uint8_t lane, uint64_t counter,
+                               const uint8_t* reserved, size_t& frame_size) {
+    EncryptedHeader* header = (EncryptedHeader*)frame;
+    header->packet_type = (uint8_t)PacketType::DATA_PACKET;
+    memcpy(header->reserved, reserved, sizeof(header->reserved));
+    header->data_length = htonl(data_size);  // AEAD ciphertext is as long as the plaintext
     
-    // Compute HMAC over encrypted data
-    if (!compute_hmac((const uint8_t*)encrypted_data, actual_encrypted_size, 
-                     hmac_key, header->hmac)) {
+    // Nonce: direction prefix and counter; never reused under one key
+    uint32_t prefix = htonl(local_nonce_prefix << 24 | lane);
+    uint64_t counter_be = htobe64(counter);
+    memcpy(header->nonce, &prefix, sizeof(prefix));
+    memcpy(header->nonce + sizeof(prefix), &counter_be, sizeof(counter_be));
+    
+    if (!aead_seal(header, data, data_size, frame + sizeof(EncryptedHeader), header->tag)) {
         return false;
     }
     
-    wrapped_size = sizeof(EncryptedHeader) + actual_encrypted_size;
+    frame_size = sizeof(EncryptedHeader) + data_size;
     return true;
 }
 
-bool CryptoManager::unwrap_data_packet(const char* wrapped, size_t wrapped_size,
-                                      char* data, size_t& data_size) {
-    if (!authenticated || wrapped_size < sizeof(EncryptedHeader)) {
+bool CryptoManager::next_counters(uint8_t lane, size_t count, uint64_t& first) {
+    first = send_counters[lane].value.fetch_add(count, std::memory_order_relaxed) + 1;
+    return first < UINT64_MAX - count;
+}
+
+uint64_t CryptoManager::sent_packets() const {
+    uint64_t sent = 0;
+    for (size_t lane = 0; lane < CRYPTO_MAX_LANES; lane++) {
+        sent += send_counters[lane].value.load(std::memory_order_relaxed);
+    }
+    return sent;
+}
+
+bool CryptoManager::parse_frame(const char* wrapped, size_t wrapped_size, size_t& encrypted_size,
+                                uint8_t& lane, uint64_t& counter) const {
+    if (wrapped_size < sizeof(EncryptedHeader)) {
         return false;
     }
     
@@ -346,37 +556,266 @@ bool CryptoManager::unwrap_data_packet(const char* wrapped, size_t wrapped_size,
         return false;
     }
     
-    uint32_t encrypted_size = ntohl(header->data_length);
+    encrypted_size = ntohl(header->data_length);
     if (wrapped_size != sizeof(EncryptedHeader) + encrypted_size) {
         return false;
     }
     
-    const char* encrypted_data = wrapped + sizeof(EncryptedHeader);
+    // Our own packets reflected back carry our direction
+    uint32_t prefix;
+    memcpy(&prefix, header->nonce, sizeof(prefix));
+    memcpy(&counter, header->nonce + sizeof(prefix), sizeof(counter));
+    counter = be64toh(counter);
+    lane = data_packet_lane(header);
+    return (ntohl(prefix) & ~0xffu) == peer_nonce_prefix << 24;
+}
+
+bool CryptoManager::wrap_data_packet(const char* data, size_t data_size,
+                                    char* wrapped, size_t& wrapped_size) {
+    size_t required_size = WRAP_HEADROOM + data_size;
+    if (wrapped_size < required_size) {
+        wrapped_size = required_size;
+        return false;
+    }
     
-    // Verify HMAC
-    uint8_t expected_hmac[HMAC_SIZE];
-    if (!compute_hmac((const uint8_t*)encrypted_data, encrypted_size, 
-                     hmac_key, expected_hmac)) {
+    uint64_t session = session_id.load(std::memory_order_acquire);
+    uint64_t counter;
+    if (!authenticated || !next_counters(0, 1, counter)) {
+        return false;
+    }
+    uint8_t reserved[3] = {static_cast<uint8_t>(send_generation.load(std::memory_order_acquire) & DATA_FLAG_KEY_ID),
+                           0, static_cast<uint8_t>(receive_prepared.load(std::memory_order_relaxed))};
+    return seal_frame(wrapped, data, data_size, 0, counter, reserved, wrapped_size) && same_session(session);
+}
+
+bool CryptoManager::wrap_in_place(char* data, size_t data_size, size_t& wrapped_size) {
+    CryptoBurstItem item = {data, data_size, false};
+    wrap_burst(&item, 1);
+    wrapped_size = item.size;
+    return item.ok;
+}
+
+size_t CryptoManager::wrap_burst(CryptoBurstItem* items, size_t count, uint8_t lane) {
+    uint64_t session = session_id.load(std::memory_order_acquire);
+    uint64_t counter;
+    if (!authenticated || !next_counters(lane, count, counter)) {
+        for (size_t i = 0; i < count; i++) {
+            items[i].ok = false;
+        }
+        return 0;
+    }
+    
+    // One counter reservation and key choice for the burst; the cipher allows
+    // exact overlap, so each ciphertext replaces its plaintext
+    uint8_t reserved[3] = {static_cast<uint8_t>(send_generation.load(std::memory_order_acquire) & DATA_FLAG_KEY_ID),
+                           0, static_cast<uint8_t>(receive_prepared.load(std::memory_order_relaxed))};
+    size_t sealed = 0;
+    for (size_t i = 0; i < count; i++, counter++) {
+        CryptoBurstItem& item = items[i];
+        item.ok = seal_frame(item.data - WRAP_HEADROOM, item.data, item.size, lane, counter, reserved, item.size);
+        sealed += item.ok;
+    }
+    
+    // The counters are never reused, but a burst straddling a new session
+    // may mix its keys with the old ones: drop it whole
+    if (sealed > 0 && !same_session(session)) {
+        for (size_t i = 0; i < count; i++) {
+            items[i].ok = false;
+        }
+        return 0;
+    }
+    return sealed;
+}
+
+bool CryptoManager::same_session(uint64_t session) const {
+    // Odd while start_session is installing keys
+    return !(session & 1) && session_id.load(std::memory_order_acquire) == session;
+}
+
+bool CryptoManager::unwrap_data_packet(const char* wrapped, size_t wrapped_size,
+                                      char* data, size_t& data_size) {
+    size_t encrypted_size;
+    uint8_t lane;
+    uint64_t counter;
+    if (!authenticated || !parse_frame(wrapped, wrapped_size, encrypted_size, lane, counter) ||
+        data_size < encrypted_size) {
+        return false;
+    }
+    
+    // Duplicates are dropped before any crypto work
+    if (!replay_check(lane, counter)) {
+        replayed_packets++;
+        return false;
+    }
+    
+    // Decrypt and verify in one pass
+    const EncryptedHeader* header = (const EncryptedHeader*)wrapped;
+    if (!aead_open(header, wrapped + sizeof(EncryptedHeader), encrypted_size, data)) {
+        Logger::log(LogLevel::WARNING, "Authentication tag mismatch for data packet");
         return false;
     }
     
-    if (!constant_time_compare(header->hmac, expected_hmac, HMAC_SIZE)) {
-        Logger::log(LogLevel::WARNING, "HMAC verification failed for data packet");
+    // Only authentic packets move the window
+    if (!replay_mark(lane, counter)) {
+        replayed_packets++;
         return false;
     }
     
-    // Decrypt the data using IV from header
-    return decrypt_packet_with_iv(encrypted_data, encrypted_size, data, data_size, header->iv);
+    data_size = encrypted_size;
+    return true;
+}
+
+bool CryptoManager::unwrap_in_place(char* wrapped, size_t wrapped_size, size_t& data_size) {
+    CryptoBurstItem item = {wrapped, wrapped_size, false};
+    unwrap_burst(&item, 1);
+    data_size = item.size;
+    return item.ok;
+}
+
+size_t CryptoManager::unwrap_burst(CryptoBurstItem* items, size_t count) {
+    uint8_t lanes[CRYPTO_BURST_MAX];
+    uint64_t counters[CRYPTO_BURST_MAX];
+    size_t encrypted_sizes[CRYPTO_BURST_MAX];
+    size_t opened = 0;
+    
+    // A burst is mostly one lane: its window stays locked until the lane changes
+    auto lock_lane = [this](std::unique_lock<std::mutex>& lock, uint8_t lane) -> ReplayWindow& {
+        ReplayWindow& window = replay_windows[lane];
+        if (lock.mutex() != &window.mutex) {
+            lock = std::unique_lock<std::mutex>(window.mutex);
+        }
+        return window;
+    };
+    
+    for (size_t start = 0; start < count; start += CRYPTO_BURST_MAX) {
+        size_t end = std::min(count, start + CRYPTO_BURST_MAX);
+        
+        // Headers, then the replay windows for the whole burst
+        for (size_t i = start; i < end; i++) {
+            items[i].ok = authenticated && parse_frame(items[i].data, items[i].size, encrypted_sizes[i - start],
+                                                       lanes[i - start], counters[i - start]);
+        }
+        {
+            std::unique_lock<std::mutex> lock;
+            for (size_t i = start; i < end; i++) {
+                if (items[i].ok && !replay_allowed(lock_lane(lock, lanes[i - start]), counters[i - start])) {
+                    items[i].ok = false;
+                    replayed_packets++;
+                }
+            }
+        }
+        
+        for (size_t i = start; i < end; i++) {
+            CryptoBurstItem& item = items[i];
+            if (!item.ok) {
+                continue;
+            }
+            const EncryptedHeader* header = (const EncryptedHeader*)item.data;
+            char* payload = item.data + sizeof(EncryptedHeader);
+            if (!aead_open(header, payload, encrypted_sizes[i - start], payload)) {
+                Logger::log(LogLevel::WARNING, "Authentication tag mismatch for data packet");
+                item.ok = false;
+            }
+        }
+        
+        // Only authentic packets move the window; a repeat within the burst fails here
+        std::unique_lock<std::mutex> lock;
+        for (size_t i = start; i < end; i++) {
+            CryptoBurstItem& item = items[i];
+            if (!item.ok) {
+                continue;
+            }
+            ReplayWindow& window = lock_lane(lock, lanes[i - start]);
+            if (!replay_allowed(window, counters[i - start])) {
+                item.ok = false;
+                replayed_packets++;
+                continue;
+            }
+            replay_record(window, counters[i - start]);
+            item.size = encrypted_sizes[i - start];
+            opened++;
+        }
+    }
+    return opened;
 }
 
-bool CryptoManager::needs_reauth() const {
+void CryptoManager::set_rekey_policy(long interval_seconds, uint64_t packets) {
+    std::lock_guard<std::mutex> lock(key_mutex);
+    rekey_interval_seconds = interval_seconds;
+    rekey_packets = packets;
+}
+
+void CryptoManager::rotate_keys() {
     if (!authenticated) {
-        return true;
+        return;
     }
     
     auto now = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::minutes>(now - auth_time);
-    return duration.count() > 60; // Re-authenticate every hour
+    auto grace = std::chrono::seconds(REKEY_GRACE_SECONDS);
+    std::lock_guard<std::mutex> lock(key_mutex);
+    
+    // Receive: once the peer's previous key has had its grace period, the
+    // key after its current one takes that slot
+    uint64_t received = receive_generation.load(std::memory_order_acquire);
+    if (received != receive_seen) {
+        receive_seen = received;
+        receive_switch_time = now;
+        Logger::log(LogLevel::INFO, "Peer switched to key generation " + std::to_string(received));
+    }
+    if (receive_prepared == received && now - receive_switch_time >= grace &&
+        prepare_key(receive_keys, peer_nonce_prefix, received + 1)) {
+        receive_prepared = received + 1;
+    }
+    
+    // Send: likewise get the next key ready, then switch when due and the
+    // peer reports it can open the next key (it derives that only after
+    // seeing ours, so switching blind could leave it a key behind)
+    uint64_t generation = send_generation.load(std::memory_order_relaxed);
+    if (send_prepared == generation && now - send_switch_time >= grace &&
+        prepare_key(send_keys, local_nonce_prefix, generation + 1)) {
+        send_prepared = generation + 1;
+    }
+    
+    uint64_t sent = sent_packets() - send_switch_counter;
+    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - send_switch_time).count();
+    bool due = (rekey_interval_seconds > 0 && elapsed >= rekey_interval_seconds) ||
+               (rekey_packets > 0 && sent >= rekey_packets);
+    if (!due || send_prepared != generation + 1 || elapsed < REKEY_MIN_SECONDS ||
+        peer_prepared.load(std::memory_order_relaxed) != static_cast<uint8_t>(generation + 1)) {
+        return;
+    }
+    
+    send_generation.store(generation + 1, std::memory_order_release);
+    send_switch_time = now;
+    send_switch_counter += sent;
+    rekeys++;
+    Logger::log(LogLevel::INFO, "Switched to send key generation " + std::to_string(generation + 1) +
+               " after " + std::to_string(sent) + " packets");
+}
+
+void CryptoManager::install_key(KeySlot& slot, uint64_t generation, const uint8_t* key) {
+    memcpy(slot.key, key, AES_KEY_SIZE);
+    slot.generation = generation;
+    slot.epoch.store(++key_epoch_counter, std::memory_order_release);
+}
+
+bool CryptoManager::prepare_key(KeySlot* slots, uint32_t nonce_prefix, uint64_t generation) {
+    // Per direction and generation: "linknet rekey" || nonce prefix || generation
+    uint8_t info[13 + sizeof(uint32_t) + sizeof(uint64_t)];
+    uint32_t prefix_be = htonl(nonce_prefix);
+    uint64_t generation_be = htobe64(generation);
+    memcpy(info, "linknet rekey", 13);
+    memcpy(info + 13, &prefix_be, sizeof(prefix_be));
+    memcpy(info + 13 + sizeof(prefix_be), &generation_be, sizeof(generation_be));
+    
+    uint8_t key[AES_KEY_SIZE];
+    if (!hkdf(aes_key, AES_KEY_SIZE, info, sizeof(info), key, AES_KEY_SIZE)) {
+        Logger::log(LogLevel::ERROR, "Failed to derive key generation " + std::to_string(generation));
+        return false;
+    }
+    install_key(slots[generation & DATA_FLAG_KEY_ID], generation, key);
+    memset(key, 0, sizeof(key));
+    return true;
 }
 
 std::string CryptoManager::generate_psk() {
@@ -395,8 +834,190 @@ std::string CryptoManager::generate_psk() {
     return psk;
 }
 
-bool CryptoManager::generate_iv(uint8_t* iv) {
-    return RAND_bytes(iv, AES_IV_SIZE) == 1;
+const char* CryptoManager::suite_name(CipherSuite suite) {
+    switch (suite) {
+        case CipherSuite::AUTO: return "auto";
+        case CipherSuite::AES_256_GCM: return "aes-256-gcm";
+        case CipherSuite::CHACHA20_POLY1305: return "chacha20-poly1305";
+    }
+    return "unknown";
+}
+
+bool CryptoManager::parse_suite(const std::string& name, CipherSuite& suite) {
+    for (CipherSuite candidate : {CipherSuite::AUTO, CipherSuite::AES_256_GCM, CipherSuite::CHACHA20_POLY1305}) {
+        if (name == suite_name(candidate)) {
+            suite = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const EVP_CIPHER* CryptoManager::suite_cipher(CipherSuite suite) {
+    switch (suite) {
+        case CipherSuite::AES_256_GCM: return EVP_aes_256_gcm();
+        case CipherSuite::CHACHA20_POLY1305: return EVP_chacha20_poly1305();
+        default: return nullptr;
+    }
+}
+
+void CryptoManager::select_suite(CipherSuite suite) {
+    std::lock_guard<std::mutex> lock(key_mutex);
+    cipher_suite = suite;
+    data_cipher = suite_cipher(suite);
+    for (KeySlot* slots : {send_keys, receive_keys}) {
+        slots[0].epoch.store(++key_epoch_counter, std::memory_order_release);
+        slots[1].epoch.store(++key_epoch_counter, std::memory_order_release);
+    }
+    Logger::log(LogLevel::INFO, std::string("Data cipher: ") + suite_name(suite));
+}
+
+double CryptoManager::benchmark_suite(CipherSuite suite) {
+    const EVP_CIPHER* cipher = suite_cipher(suite);
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!cipher || !ctx) {
+        EVP_CIPHER_CTX_free(ctx);
+        return 0;
+    }
+    
+    // Throwaway key, set up once; per-packet work as on the data path
+    uint8_t key[AES_KEY_SIZE] = {0};
+    uint8_t nonce[AEAD_NONCE_SIZE] = {0};
+    uint8_t tag[AEAD_TAG_SIZE];
+    std::vector<unsigned char> packet(CIPHER_BENCH_PACKET, 0x5a);
+    
+    if (EVP_EncryptInit_ex(ctx, cipher, NULL, key, NULL) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        return 0;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::microseconds(CIPHER_BENCH_USEC);
+    size_t bytes = 0;
+    int len;
+    do {
+        for (int i = 0; i < 16; i++) {
+            if (EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, nonce) != 1 ||
+                EVP_EncryptUpdate(ctx, packet.data(), &len, packet.data(), packet.size()) != 1 ||
+                EVP_EncryptFinal_ex(ctx, packet.data() + len, &len) != 1 ||
+                EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag) != 1) {
+                EVP_CIPHER_CTX_free(ctx);
+                return 0;
+            }
+            bytes += packet.size();
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    
+    EVP_CIPHER_CTX_free(ctx);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return bytes / seconds;
+}
+
+bool CryptoManager::compute_auth_tag(const EncryptedHeader* header, const uint8_t* payload, size_t payload_len,
+                                     const uint8_t* key, size_t key_len, uint8_t* tag) {
+    // Covers the type (steps under the same key differ by it) and the
+    // capability and cipher suite bytes as well as the payload
+    std::vector<uint8_t> signed_data(1, header->packet_type);
+    signed_data.insert(signed_data.end(), header->reserved, header->reserved + sizeof(header->reserved));
+    if (payload_len > 0) {
+        signed_data.insert(signed_data.end(), payload, payload + payload_len);
+    }
+    
+    uint8_t hmac[HMAC_SIZE];
+    if (!compute_hmac(signed_data.data(), signed_data.size(), key, key_len, hmac)) {
+        return false;
+    }
+    memcpy(tag, hmac, AUTH_TAG_SIZE);
+    return true;
+}
+
+void CryptoManager::start_session(bool client) {
+    // Bursts in flight meanwhile see the change and drop what they sealed
+    session_id.fetch_add(1, std::memory_order_acq_rel);
+    local_nonce_prefix = client ? NONCE_PREFIX_CLIENT : NONCE_PREFIX_SERVER;
+    peer_nonce_prefix = client ? NONCE_PREFIX_SERVER : NONCE_PREFIX_CLIENT;
+    
+    for (size_t lane = 0; lane < CRYPTO_MAX_LANES; lane++) {
+        ReplayWindow& window = replay_windows[lane];
+        std::lock_guard<std::mutex> lock(window.mutex);
+        window.top = 0;
+        memset(window.bitmap, 0, sizeof(window.bitmap));
+    }
+    
+    // The counters run on across key switches, so one replay window per lane covers both slots
+    std::lock_guard<std::mutex> lock(key_mutex);
+    memcpy(aes_key, handshake_data_key, AES_KEY_SIZE);
+    memset(handshake_data_key, 0, sizeof(handshake_data_key));
+    install_key(send_keys[0], 0, aes_key);
+    install_key(receive_keys[0], 0, aes_key);
+    send_prepared = prepare_key(send_keys, local_nonce_prefix, 1) ? 1 : 0;
+    receive_prepared = prepare_key(receive_keys, peer_nonce_prefix, 1) ? 1 : 0;
+    peer_prepared = 0;
+    send_generation = 0;
+    receive_generation = 0;
+    receive_seen = 0;
+    send_switch_counter = sent_packets();
+    send_switch_time = std::chrono::steady_clock::now();
+    receive_switch_time = send_switch_time;
+    rekeys = 0;
+    session_id.fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool CryptoManager::fill_auth_header(char* buffer, PacketType type, size_t payload_len) {
+    EncryptedHeader* header = (EncryptedHeader*)buffer;
+    header->packet_type = (uint8_t)type;
+    memset(header->reserved, 0, sizeof(header->reserved));
+    header->data_length = htonl(payload_len);
+    return generate_nonce(header->nonce);
+}
+
+bool CryptoManager::replay_allowed(const ReplayWindow& window, uint64_t counter) {
+    if (counter == 0) {
+        return false;
+    }
+    if (counter > window.top) {
+        return true;
+    }
+    // The word ahead of the top one is reused on the next advance, so one word is not usable
+    if (window.top - counter >= 64 * (REPLAY_WINDOW_WORDS - 1)) {
+        return false;
+    }
+    uint64_t word = window.bitmap[(counter / 64) % REPLAY_WINDOW_WORDS];
+    return !(word & (1ULL << (counter % 64)));
+}
+
+bool CryptoManager::replay_check(uint8_t lane, uint64_t counter) {
+    ReplayWindow& window = replay_windows[lane];
+    std::lock_guard<std::mutex> lock(window.mutex);
+    return replay_allowed(window, counter);
+}
+
+bool CryptoManager::replay_mark(uint8_t lane, uint64_t counter) {
+    ReplayWindow& window = replay_windows[lane];
+    std::lock_guard<std::mutex> lock(window.mutex);
+    if (!replay_allowed(window, counter)) {
+        return false;
+    }
+    replay_record(window, counter);
+    return true;
+}
+
+void CryptoManager::replay_record(ReplayWindow& window, uint64_t counter) {
+    if (counter > window.top) {
+        // Clear the words the window slides over (all of them after a long jump)
+        uint64_t top_word = window.top / 64;
+        uint64_t new_word = counter / 64;
+        uint64_t clear = std::min<uint64_t>(new_word - top_word, REPLAY_WINDOW_WORDS);
+        for (uint64_t i = 1; i <= clear; i++) {
+            window.bitmap[(top_word + i) % REPLAY_WINDOW_WORDS] = 0;
+        }
+        window.top = counter;
+    }
+    window.bitmap[(counter / 64) % REPLAY_WINDOW_WORDS] |= 1ULL << (counter % 64);
+}
+
+bool CryptoManager::generate_nonce(uint8_t* nonce) {
+    return RAND_bytes(nonce, AEAD_NONCE_SIZE) == 1;
 }
 
 bool CryptoManager::compute_hmac(const uint8_t* data, size_t data_len, 
@@ -426,3 +1047,15 @@ bool CryptoManager::pbkdf2(const uint8_t* password, size_t password_len,
                             salt, salt_len, iterations,
                             EVP_sha256(), key_len, key) == 1;
 }
+
+bool CryptoManager::hkdf(const uint8_t* key, size_t key_len, const uint8_t* info, size_t info_len,
+                        uint8_t* out, size_t out_len) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+    bool ok = ctx && EVP_PKEY_derive_init(ctx) > 0 &&
+              EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) > 0 &&
+              EVP_PKEY_CTX_set1_hkdf_key(ctx, key, key_len) > 0 &&
+              EVP_PKEY_CTX_add1_hkdf_info(ctx, info, info_len) > 0 &&
+              EVP_PKEY_derive(ctx, out, &out_len) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ok;
+}
@@ -7,14 +7,30 @@
 #include <openssl/sha.h>
 #include <openssl/evp.h>
 #include <random>
+#include <memory>
+#include <cstddef>
 
 // Crypto constants
 #define AES_KEY_SIZE 32      // AES-256
-#define AES_IV_SIZE 16       // AES block size
-#define AES_BLOCK_SIZE 16    // AES block size for padding
+#define AEAD_NONCE_SIZE 12   // AES-GCM nonce
+#define AEAD_TAG_SIZE 16     // AES-GCM authentication tag
 #define AUTH_KEY_SIZE 64     // Pre-shared key size
 #define HMAC_SIZE 32         // SHA-256 HMAC size
+#define AUTH_TAG_SIZE 16     // Truncated HMAC carried by auth messages
 #define SALT_SIZE 16         // Salt for key derivation
+#define HANDSHAKE_SALT_SIZE (2 * SALT_SIZE)  // Client salt and server nonce, which salt the session keys
+#define AUTH_RETRY_SECONDS 2 // Auth request resend interval on lossy transports
+#define NONCE_PREFIX_CLIENT 0x01      // Data nonce direction of packets the client sends
+#define NONCE_PREFIX_SERVER 0x02      // ... and the server sends (the key is shared)
+#define CRYPTO_MAX_LANES 256          // Counter spaces per direction, one per sender TUN queue
+#define REPLAY_WINDOW_WORDS 64        // Replay bitmap words per lane; 64 * (words - 1) counters tolerated out of order
+#define CRYPTO_BURST_MAX 64           // Packets unwrap_burst checks against the replay window at once
+#define REKEY_INTERVAL_SECONDS 3600   // Default: next send key after an hour ...
+#define REKEY_PACKETS (1ULL << 32)    // ... or after this many packets under one key
+#define REKEY_GRACE_SECONDS 2         // A replaced key still opens late packets this long
+#define REKEY_MIN_SECONDS 30          // Between send key switches at most (rate limit)
+#define CIPHER_BENCH_USEC 20000  // Startup benchmark time per cipher suite
+#define CIPHER_BENCH_PACKET 1400 // Startup benchmark packet size
 
 // Packet types
 enum class PacketType : uint8_t {
@@ -22,31 +38,157 @@ enum class PacketType : uint8_t {
     AUTH_RESPONSE = 0x02,
     AUTH_SUCCESS = 0x03,
     AUTH_FAILED = 0x04,
+    AUTH_CONFIRM = 0x05,
     DATA_PACKET = 0x10,
     KEEPALIVE = 0x20
 };
 
-// Encrypted packet header
+// Flags carried in reserved[0] of data packets
+#define DATA_FLAG_KEY_ID 0x01  // Key slot the packet is sealed with (key generation parity)
+
+// reserved[2] of data packets: low byte of the key generation the sender has
+// ready for receiving. Each side switches its send key to a generation only
+// once the peer reports it ready, so a lost packet cannot strand the peer.
+
+// Capability flags carried in reserved[0] of AUTH_REQUEST / AUTH_RESPONSE
+#define AUTH_CAP_GSO_RX 0x01  // Accepts data payloads prefixed with a virtio_net_hdr
+#define AUTH_CAP_GSO_TX 0x02  // Sends such payloads (TUN offload mode) when the peer accepts them
+
+// Data cipher suites. AUTH_REQUEST carries the client's preferred suite in
+// reserved[1] and how much faster it ran there in reserved[2] (percent,
+// capped at 254; 255 means configured); AUTH_RESPONSE carries the server's
+// choice in reserved[1]. A configured suite beats a benchmarked one. If both
+// sides configure different suites, the server keeps its own and the client
+// refuses the session.
+#define SUITE_MARGIN_CONFIGURED 255
+enum class CipherSuite : uint8_t {
+    AUTO = 0,               // Configuration only: pick by startup benchmark
+    AES_256_GCM = 1,
+    CHACHA20_POLY1305 = 2
+};
+
+// Encrypted packet header. Data packets are AES-256-GCM (or ChaCha20-Poly1305):
+// the header up to the tag is authenticated along with the ciphertext, which
+// is as long as the plaintext. Their nonce is a 32-bit prefix (the sender's
+// direction in the top byte, its lane in the low byte) and a 64-bit packet
+// counter, both big-endian. Auth messages carry a
+// random nonce and a truncated HMAC in the tag instead, over the packet type,
+// reserved bytes and payload.
 struct EncryptedHeader {
     uint8_t packet_type;
     uint8_t reserved[3];
     uint32_t data_length;
-    uint8_t iv[AES_IV_SIZE];
-    uint8_t hmac[HMAC_SIZE];
+    uint8_t nonce[AEAD_NONCE_SIZE];
+    uint8_t tag[AEAD_TAG_SIZE];
 } __attribute__((packed));
 
+#define AEAD_AAD_SIZE offsetof(EncryptedHeader, tag)  // Header bytes covered by the tag
+
+// A data packet's lane: the sender's TUN queue. Each lane has its own counter
+// and replay window, so lanes may fall behind one another by any amount. A
+// datagram receiver unwraps each lane on one of its pipelines and writes it
+// to the matching TUN queue, which keeps flows in order.
+inline uint8_t data_packet_lane(const EncryptedHeader* header) {
+    return header->nonce[3];
+}
+
+// Room an in-place wrap needs in front of the plaintext (GCM does not pad)
+#define WRAP_HEADROOM sizeof(EncryptedHeader)
+
+// One packet of a burst, wrapped or unwrapped in place
+struct CryptoBurstItem {
+    char* data;   // Wrap: plaintext with WRAP_HEADROOM in front; unwrap: the frame
+    size_t size;  // In: input length; out: frame (wrap) or plaintext (unwrap) length
+    bool ok;      // Out
+};
+
 class CryptoManager {
 private:
+    // Handshake step this side waits for
+    enum class HandshakeState : uint8_t {
+        IDLE,
+        REQUESTED,   // Client: sent AUTH_REQUEST, waits for AUTH_RESPONSE
+        CHALLENGED,  // Server: sent AUTH_RESPONSE, waits for AUTH_CONFIRM
+        CONFIRMED    // Client: sent AUTH_CONFIRM, keys derived, waits for AUTH_SUCCESS
+    };
+    
+    // One data key; each direction has two, picked by generation parity
+    struct KeySlot {
+        uint8_t key[AES_KEY_SIZE];
+        uint64_t generation;          // Guarded by key_mutex like the key
+        std::atomic<uint64_t> epoch;  // Changes with key or cipher; per-thread contexts rekey
+    };
+    
     bool initialized;
     std::string pre_shared_key;
     
-    // Encryption keys
+    // Session data key and rekey master; guarded by key_mutex, as the
+    // heartbeat derives new generations from it
     uint8_t aes_key[AES_KEY_SIZE];
-    uint8_t hmac_key[AES_KEY_SIZE];
     
     // Authentication state
     bool authenticated;
-    std::chrono::steady_clock::time_point auth_time;
+    uint8_t local_capabilities;
+    uint8_t peer_capabilities;
+    
+    // Handshake in flight. Nothing of it touches the current session until
+    // the peer has answered this handshake's fresh salt or nonce.
+    std::mutex handshake_mutex;
+    HandshakeState handshake_state;
+    uint8_t handshake_salt[HANDSHAKE_SALT_SIZE];  // Client salt, then server nonce
+    uint8_t handshake_capabilities;               // Peer's, for the session it starts
+    CipherSuite handshake_suite;
+    uint8_t handshake_data_key[AES_KEY_SIZE];     // Keys derived from handshake_salt; the
+    uint8_t handshake_auth_key[AES_KEY_SIZE];     // data key becomes aes_key in start_session
+    
+    // Cipher suite negotiation
+    CipherSuite preferred_suite;    // Configured, or the faster one in the startup benchmark
+    uint8_t preference_margin;      // How much faster preferred_suite is here (percent, capped)
+    bool suite_configured;          // preferred_suite came from --cipher
+    CipherSuite cipher_suite;       // Negotiated data cipher
+    const EVP_CIPHER* data_cipher;  // Guarded by key_mutex
+    
+    // Data keys per direction: generation 0 is aes_key, later ones are derived
+    // from it by HKDF. The next key is installed in the idle slot ahead of time,
+    // so switching is one store and the old key keeps working meanwhile.
+    std::mutex key_mutex;             // Slot keys, data_cipher and the rekey schedule
+    KeySlot send_keys[2];
+    KeySlot receive_keys[2];
+    std::atomic<uint64_t> send_generation;     // Key new packets are sealed with
+    std::atomic<uint64_t> receive_generation;  // Newest key the peer has been seen using
+    
+    // Rekey schedule (rotate_keys)
+    long rekey_interval_seconds;
+    uint64_t rekey_packets;
+    uint64_t send_prepared;          // Generation waiting in the idle send slot
+    std::atomic<uint64_t> receive_prepared;  // ... and receive slot, reported in every data packet
+    std::atomic<uint8_t> peer_prepared;      // What the peer last reported (low byte)
+    uint64_t receive_seen;
+    uint64_t send_switch_counter;    // sent_packets() at the last switch
+    std::chrono::steady_clock::time_point send_switch_time;
+    std::chrono::steady_clock::time_point receive_switch_time;
+    std::atomic<uint64_t> rekeys;
+    
+    // One lane's send counter: the last one used, the first packet gets 1.
+    // Counters never go back, not even for a new session.
+    struct alignas(64) LaneCounter {
+        std::atomic<uint64_t> value;
+    };
+    
+    // One lane's replay protection, reset per session
+    struct alignas(64) ReplayWindow {
+        std::mutex mutex;
+        uint64_t top;                          // Highest counter accepted
+        uint64_t bitmap[REPLAY_WINDOW_WORDS];  // Accepted counters, one bit each, as a ring
+    };
+    
+    // Counter nonces and replay protection, per lane
+    uint32_t local_nonce_prefix;  // Direction byte of the nonces we send
+    uint32_t peer_nonce_prefix;   // ... and the peer sends
+    std::unique_ptr<LaneCounter[]> send_counters;    // CRYPTO_MAX_LANES
+    std::unique_ptr<ReplayWindow[]> replay_windows;  // CRYPTO_MAX_LANES
+    std::atomic<uint64_t> session_id;     // Bumped before and after start_session installs keys
+    std::atomic<uint64_t> replayed_packets;
     
     // Random number generator
     std::random_device rd;
@@ -56,57 +198,156 @@ public:
     CryptoManager();
     ~CryptoManager();
     
-    // Initialize with pre-shared key
-    bool initialize(const std::string& psk);
+    // Initialize with pre-shared key; AUTO benchmarks the suites to pick a preference
+    bool initialize(const std::string& psk, CipherSuite suite = CipherSuite::AUTO);
     
-    // Key derivation from PSK
-    bool derive_keys(const uint8_t* salt, size_t salt_len);
-    
-    // Authentication protocol
+    // Authentication protocol, a challenge-response so every session gets
+    // fresh keys (a replayed message never restarts one):
+    //   client: AUTH_REQUEST   client salt, PSK tag
+    //   server: AUTH_RESPONSE  client salt and server nonce, PSK tag
+    //   client: AUTH_CONFIRM   PSK tag over both; keys derived from both
+    //   server: AUTH_SUCCESS   tag with the derived HMAC key; session starts
+    // Each handler fills in the next message, if any.
     bool create_auth_request(char* buffer, size_t& buffer_size);
     bool handle_auth_request(const char* buffer, size_t buffer_size, 
                            char* response, size_t& response_size);
-    bool handle_auth_response(const char* buffer, size_t buffer_size);
-    
-    // Encryption/Decryption
-    bool encrypt_packet(const char* plaintext, size_t plaintext_size,
-                       char* ciphertext, size_t& ciphertext_size);
-    bool encrypt_packet_with_iv(const char* plaintext, size_t plaintext_size,
-                               char* ciphertext, size_t& ciphertext_size, const uint8_t* iv);
-    bool decrypt_packet(const char* ciphertext, size_t ciphertext_size,
-                       char* plaintext, size_t& plaintext_size);
-    bool decrypt_packet_with_iv(const char* ciphertext, size_t ciphertext_size,
-                               char* plaintext, size_t& plaintext_size, const uint8_t* iv);
-    
-    // Packet handling
+    bool handle_auth_response(const char* buffer, size_t buffer_size,
+                            char* confirm, size_t& confirm_size);
+    bool handle_auth_confirm(const char* buffer, size_t buffer_size,
+                           char* response, size_t& response_size);
+    bool handle_auth_success(const char* buffer, size_t buffer_size);
+    
+    // Packet handling (copying: data and wrapped are separate buffers)
     bool wrap_data_packet(const char* data, size_t data_size,
                          char* wrapped, size_t& wrapped_size);
     bool unwrap_data_packet(const char* wrapped, size_t wrapped_size,
                            char* data, size_t& data_size);
     
+    // In place: the caller owns WRAP_HEADROOM bytes in front of data, where
+    // the frame starts; wrapped_size covers header and ciphertext.
+    bool wrap_in_place(char* data, size_t data_size, size_t& wrapped_size);
+    
+    // In place: the plaintext is left WRAP_HEADROOM bytes into the frame
+    bool unwrap_in_place(char* wrapped, size_t wrapped_size, size_t& data_size);
+    
+    // In place, for a burst (safe from any number of threads): per-burst
+    // work such as the nonce counter and replay window locking is done once.
+    // Each item's ok flag is set; returns how many succeeded. Wrapped packets
+    // take their counters from lane (the caller's TUN queue).
+    size_t wrap_burst(CryptoBurstItem* items, size_t count, uint8_t lane = 0);
+    size_t unwrap_burst(CryptoBurstItem* items, size_t count);
+    
+    // Capability exchange (AUTH_CAP_* flags, valid once authenticated)
+    void set_local_capabilities(uint8_t caps) { local_capabilities = caps; }
+    uint8_t get_peer_capabilities() const { return peer_capabilities; }
+    
+    // Negotiated data cipher (valid once authenticated)
+    CipherSuite get_cipher_suite() const { return cipher_suite; }
+    
+    // Data packets dropped as replays or duplicates
+    uint64_t get_replayed_packets() const { return replayed_packets; }
+    
+    // Rekeying: the send key changes after interval_seconds or packets
+    // (0 disables either), at most every REKEY_MIN_SECONDS
+    void set_rekey_policy(long interval_seconds, uint64_t packets);
+    
+    // Switch the send key when due and install the next keys in the idle
+    // slots once the grace period is over. Call periodically, off the data path.
+    void rotate_keys();
+    
+    // Send key switches this session
+    uint64_t get_rekeys() const { return rekeys; }
+    
     // Status
     bool is_authenticated() const { return authenticated; }
-    bool needs_reauth() const;
     void set_authenticated(bool auth_state) { authenticated = auth_state; }
     
     // Utilities
     static std::string generate_psk();
+    static const char* suite_name(CipherSuite suite);
+    static bool parse_suite(const std::string& name, CipherSuite& suite);
     static bool verify_hmac(const uint8_t* data, size_t data_len,
                            const uint8_t* hmac, const uint8_t* key);
 
 private:
     // Internal crypto functions
-    bool generate_iv(uint8_t* iv);
+    bool generate_nonce(uint8_t* nonce);
+    
+    // Derive the handshake keys from the PSK (caller holds handshake_mutex)
+    bool derive_keys(const uint8_t* salt, size_t salt_len);
+    
+    // New keys: set the nonce directions, restart the replay window and
+    // install the handshake's data key as generation 0, and generation 1, of
+    // both directions (caller holds handshake_mutex)
+    void start_session(bool client);
+    
+    // Auth message header with a random nonce; the tag is left to the caller
+    bool fill_auth_header(char* buffer, PacketType type, size_t payload_len);
+    
+    // Install a key under a new epoch (caller holds key_mutex)
+    void install_key(KeySlot& slot, uint64_t generation, const uint8_t* key);
+    
+    // Derive a direction's key generation into its slot (caller holds key_mutex)
+    bool prepare_key(KeySlot* slots, uint32_t nonce_prefix, uint64_t generation);
+    
+    // Key the calling thread's context from a slot (under key_mutex)
+    bool load_key(EVP_CIPHER_CTX* ctx, KeySlot& slot, bool encrypt, uint64_t& epoch, uint64_t& generation);
+    
+    // Replay window: check before decrypting, mark after the tag verified.
+    // mark fails if another thread accepted the same counter meanwhile.
+    bool replay_check(uint8_t lane, uint64_t counter);
+    bool replay_mark(uint8_t lane, uint64_t counter);
+    static bool replay_allowed(const ReplayWindow& window, uint64_t counter);  // Caller holds window.mutex
+    static void replay_record(ReplayWindow& window, uint64_t counter);         // Caller holds window.mutex
+    
+    // No session started since session (a session_id value) was read
+    bool same_session(uint64_t session) const;
+    
+    // Reserve count send counters of a lane; false once they run out
+    bool next_counters(uint8_t lane, size_t count, uint64_t& first);
+    
+    // Packets sent so far, all lanes together
+    uint64_t sent_packets() const;
+    
+    // Check a data frame's header; lane and counter come from its nonce
+    bool parse_frame(const char* wrapped, size_t wrapped_size, size_t& encrypted_size, uint8_t& lane,
+                     uint64_t& counter) const;
+    
+    // Negotiated AEAD with header as AAD; ciphertext and plaintext may be the same
+    // buffer. The header's key ID picks the slot. Uses the calling thread's
+    // contexts, keyed once per slot epoch.
+    bool aead_seal(const EncryptedHeader* header, const char* plaintext, size_t size,
+                   char* ciphertext, uint8_t* tag);
+    bool aead_open(const EncryptedHeader* header, const char* ciphertext, size_t size,
+                   char* plaintext);
+    
+    // Switch the data path to a negotiated suite
+    void select_suite(CipherSuite suite);
+    static const EVP_CIPHER* suite_cipher(CipherSuite suite);
+    
+    // Bytes per second one suite seals here, in packets of CIPHER_BENCH_PACKET
+    static double benchmark_suite(CipherSuite suite);
+    
+    // HMAC over an auth message's type, reserved bytes and payload
+    bool compute_auth_tag(const EncryptedHeader* header, const uint8_t* payload, size_t payload_len,
+                          const uint8_t* key, size_t key_len, uint8_t* tag);
+    
+    // Fill in a data packet header at frame and encrypt data behind it;
+    // reserved holds the key ID and reported receive generation
+    bool seal_frame(char* frame, const char* data, size_t data_size, uint8_t lane, uint64_t counter,
+                    const uint8_t* reserved, size_t& frame_size);
     bool compute_hmac(const uint8_t* data, size_t data_len, 
                      const uint8_t* key, uint8_t* hmac);
     bool compute_hmac(const uint8_t* data, size_t data_len, 
                      const uint8_t* key, size_t key_len, uint8_t* hmac);
     bool constant_time_compare(const uint8_t* a, const uint8_t* b, size_t len);
     
-    // Key derivation (PBKDF2)
+    // Key derivation (PBKDF2 from the PSK, HKDF-SHA256 for rekeying)
     bool pbkdf2(const uint8_t* password, size_t password_len,
                const uint8_t* salt, size_t salt_len,
                int iterations, uint8_t* key, size_t key_len);
+    bool hkdf(const uint8_t* key, size_t key_len, const uint8_t* info, size_t info_len,
+              uint8_t* out, size_t out_len);
 };
 
 #endif // CRYPTO_MANAGER_H
@@ -0,0 +1,206 @@
+#include "crypto_pool.h"
+
+CryptoPool::CryptoPool(size_t worker_count, Transform transform, RingWaiter& owner_waiter, bool flow_steered,
+                       ThreadInit thread_init)
+    : transform(std::move(transform)), thread_init(std::move(thread_init)), owner_waiter(owner_waiter), flow_steered(flow_steered), stopping(false),
+      window(CRYPTO_REORDER_WINDOW), next_seq(0), release_seq(0), next_worker(0) {
+    for (Slot& slot : window) {
+        slot.done = false;
+    }
+    finished.reserve(CRYPTO_REORDER_WINDOW);
+    released.reserve(CRYPTO_REORDER_WINDOW);
+
+    worker_count = std::max<size_t>(1, std::min<size_t>(worker_count, CRYPTO_MAX_WORKERS));
+    for (size_t i = 0; i < worker_count; i++) {
+        workers.push_back(std::make_unique<Worker>(i));
+    }
+    for (auto& worker : workers) {
+        worker->thread = std::thread(&CryptoPool::worker_loop, this, worker.get());
+    }
+}
+
+CryptoPool::~CryptoPool() {
+    stopping = true;
+    for (auto& worker : workers) {
+        worker->waiter.wakeup();
+    }
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void CryptoPool::worker_loop(Worker* worker) {
+    if (thread_init) {
+        thread_init(worker->index);
+    }
+
+    std::vector<CryptoJob> jobs;
+    jobs.reserve(CRYPTO_WORKER_BATCH);
+
+    auto ready = [this, worker] { return !worker->input.empty() || stopping; };
+
+    while (!stopping) {
+        if (!worker->waiter.wait(ready)) {
+            continue;
+        }
+
+        // The whole batch goes through the transform as one burst
+        worker->input.pop_batch(jobs, CRYPTO_WORKER_BATCH);
+        transform(jobs.data(), jobs.size());
+        uint64_t bytes = 0;
+        for (auto& job : jobs) {
+            bytes += job.input_size;
+            // Only fails if the owner gave up on many packets that are still
+            // queued here; such a packet is freed and times out in the window
+            worker->output.push(std::move(job));
+        }
+        worker->packets.fetch_add(jobs.size(), std::memory_order_relaxed);
+        worker->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        jobs.clear();
+
+        owner_waiter.notify();
+    }
+}
+
+bool CryptoPool::submit(PacketPtr packet) {
+    if (flow_steered) {
+        // Another worker would break the flow's order, so a backed-up worker drops
+        CryptoJob job;
+        job.seq = next_seq;
+        job.input_size = packet->size();
+        job.ok = false;
+        job.packet = std::move(packet);
+        Worker& worker = *workers[job.packet->flow_hash % workers.size()];
+        if (!worker.input.push(std::move(job))) {
+            return false;
+        }
+        next_seq++;
+        worker.waiter.notify();
+        return true;
+    }
+
+    // Window full: wait for the oldest packet to come back or time out
+    while (next_seq - release_seq >= window.size()) {
+        poll();
+        if (next_seq - release_seq < window.size()) {
+            break;
+        }
+        owner_waiter.wait([this] { return has_completions(); }, time_left());
+    }
+
+    uint64_t seq = next_seq++;
+    Slot& slot = window[seq & (window.size() - 1)];
+    slot.done = false;
+    slot.deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(CRYPTO_REORDER_TIMEOUT_USEC);
+    slot.job.seq = seq;
+    slot.job.input_size = packet->size();
+    slot.job.ok = false;
+
+    CryptoJob job;
+    job.seq = seq;
+    job.input_size = slot.job.input_size;
+    job.ok = false;
+    job.packet = std::move(packet);
+
+    // Round robin, skipping workers that are backed up
+    for (size_t i = 0; i < workers.size(); i++) {
+        Worker& worker = *workers[next_worker];
+        next_worker = (next_worker + 1) % workers.size();
+        if (worker.input.push(std::move(job))) {
+            worker.waiter.notify();
+            return true;
+        }
+    }
+
+    // Every worker is backed up: do this one here
+    transform(&job, 1);
+    slot.job = std::move(job);
+    slot.done = true;
+    return true;
+}
+
+void CryptoPool::poll() {
+    for (auto& worker : workers) {
+        worker->output.pop_batch(finished, CRYPTO_REORDER_WINDOW);
+    }
+
+    // Flows are ordered per worker already
+    if (flow_steered) {
+        release_seq += finished.size();
+        for (auto& job : finished) {
+            released.push_back(std::move(job));
+        }
+        finished.clear();
+        return;
+    }
+
+    for (auto& job : finished) {
+        // Given up on already: just free the buffer
+        if (job.seq < release_seq) {
+            continue;
+        }
+        Slot& slot = window[job.seq & (window.size() - 1)];
+        slot.job = std::move(job);
+        slot.done = true;
+    }
+    finished.clear();
+
+    // Release in order; only the oldest packet's deadline matters
+    bool have_now = false;
+    std::chrono::steady_clock::time_point now;
+    while (release_seq != next_seq) {
+        Slot& slot = window[release_seq & (window.size() - 1)];
+        if (!slot.done) {
+            if (!have_now) {
+                now = std::chrono::steady_clock::now();
+                have_now = true;
+            }
+            if (now < slot.deadline) {
+                break;
+            }
+            slot.job.packet.reset();
+            slot.job.ok = false;
+        }
+        released.push_back(std::move(slot.job));
+        slot.done = false;
+        release_seq++;
+    }
+}
+
+size_t CryptoPool::collect(std::vector<CryptoJob>& out) {
+    poll();
+
+    size_t count = released.size();
+    for (auto& job : released) {
+        out.push_back(std::move(job));
+    }
+    released.clear();
+    return count;
+}
+
+void CryptoPool::set_spin_usec(long usec) {
+    for (auto& worker : workers) {
+        worker->waiter.set_spin_usec(usec);
+    }
+}
+
+bool CryptoPool::has_completions() const {
+    for (const auto& worker : workers) {
+        if (!worker->output.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+long CryptoPool::time_left() const {
+    if (next_seq == release_seq || flow_steered) {
+        return -1;
+    }
+
+    const Slot& slot = window[release_seq & (window.size() - 1)];
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(slot.deadline - std::chrono::steady_clock::now());
+    return std::max<long>(left.count(), 0);
+}
@@ -0,0 +1,120 @@
+#ifndef CRYPTO_POOL_H
+#define CRYPTO_POOL_H
+
+#include "utils.h"
+#include "packet_pool.h"
+#include "packet_ring.h"
+#include <functional>
+#include <thread>
+
+// Worker pool settings
+#define CRYPTO_WORKER_BATCH 64              // Packets a worker takes per wakeup
+#define CRYPTO_REORDER_WINDOW 1024          // Packets in flight per pool (power of two)
+#define CRYPTO_REORDER_TIMEOUT_USEC 20000   // How long the oldest packet may hold back the rest
+
+// One packet passing through a crypto pool
+struct CryptoJob {
+    uint64_t seq;        // Submission order
+    PacketPtr packet;    // Empty if the reorder stage gave up waiting for it
+    size_t input_size;   // Packet size when submitted
+    bool ok;             // Transform result
+};
+
+// Runs a packet transform (wrap or unwrap in place) on worker threads and
+// hands the results back in submission order. Each packet is numbered when
+// submitted; finished packets wait in a bounded reorder window until all
+// earlier ones are out. A packet not back within the timeout is given up, so
+// one stalled worker cannot hold back the rest, and its late result is freed.
+//
+// Flow-steered pools instead send each packet to the worker its flow_hash
+// picks. A flow then stays on one worker and in order without the reorder
+// window, and results are handed back as soon as they are done.
+//
+// submit(), collect() and the rest of the interface belong to one owner
+// thread; workers wake it through the owner's RingWaiter.
+class CryptoPool {
+public:
+    typedef std::function<void(CryptoJob* jobs, size_t count)> Transform;  // Sets each job's ok
+    typedef std::function<void(size_t)> ThreadInit;  // Runs first on each worker (placement, name)
+
+private:
+    struct Worker {
+        size_t index;
+        std::thread thread;
+        SpscRing<CryptoJob> input;   // Owner -> worker
+        SpscRing<CryptoJob> output;  // Worker -> owner
+        RingWaiter waiter;
+        std::atomic<uint64_t> packets;  // Load counters
+        std::atomic<uint64_t> bytes;
+
+        explicit Worker(size_t index)
+            : index(index), input(CRYPTO_REORDER_WINDOW), output(2 * CRYPTO_REORDER_WINDOW), packets(0), bytes(0) {}
+    };
+
+    struct Slot {
+        CryptoJob job;
+        bool done;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    Transform transform;
+    ThreadInit thread_init;
+    RingWaiter& owner_waiter;
+    bool flow_steered;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping;
+
+    // Reorder window, indexed by seq
+    std::vector<Slot> window;
+    uint64_t next_seq;     // Given to the next submitted packet
+    uint64_t release_seq;  // Oldest packet not yet released
+    size_t next_worker;
+
+    std::vector<CryptoJob> finished;  // Worker output being sorted into the window
+    std::vector<CryptoJob> released;  // In order, not yet collected
+
+    void worker_loop(Worker* worker);
+
+    // Sort worker output into the window, then release what is in order
+    void poll();
+
+public:
+    CryptoPool(size_t worker_count, Transform transform, RingWaiter& owner_waiter, bool flow_steered = false,
+               ThreadInit thread_init = ThreadInit());
+    ~CryptoPool();
+
+    // Disable copy constructor and assignment operator
+    CryptoPool(const CryptoPool&) = delete;
+    CryptoPool& operator=(const CryptoPool&) = delete;
+
+    // Number the packet and hand it to the next worker; blocks while the
+    // window is full (at most until the oldest packet times out). Flow-steered:
+    // false (packet dropped) if the flow's worker is backed up.
+    bool submit(PacketPtr packet);
+
+    // Append the packets now released in order; returns how many
+    size_t collect(std::vector<CryptoJob>& out);
+
+    // Worker output is waiting (for the owner's ready() predicate)
+    bool has_completions() const;
+
+    // Packets submitted but not yet collected
+    bool idle() const { return next_seq == release_seq && released.empty(); }
+
+    // Microseconds until the oldest packet times out, -1 with none in flight
+    // (or nothing to time out)
+    long time_left() const;
+
+    size_t size() const { return workers.size(); }
+
+    // Latency mode: workers spin this long before parking
+    void set_spin_usec(long usec);
+
+    bool is_flow_steered() const { return flow_steered; }
+
+    // Packets and bytes a worker has processed (any thread)
+    uint64_t worker_packets(size_t index) const { return workers[index]->packets; }
+    uint64_t worker_bytes(size_t index) const { return workers[index]->bytes; }
+};
+
+#endif // CRYPTO_POOL_H
@@ -0,0 +1,102 @@
+#include "event_loop.h"
+#include <sys/eventfd.h>
+#include <algorithm>
+
+EventLoop::EventLoop() : epoll_fd(-1), wakeup_fd(-1), busy_poll_usec(0) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        Logger::log(LogLevel::ERROR, "Failed to create epoll instance: " +
+                   NetworkUtils::get_error_string(errno));
+        return;
+    }
+
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd < 0) {
+        Logger::log(LogLevel::ERROR, "Failed to create wakeup eventfd: " +
+                   NetworkUtils::get_error_string(errno));
+        return;
+    }
+
+    // Level-triggered so a pending wakeup is never missed
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeup_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev) < 0) {
+        Logger::log(LogLevel::ERROR, "Failed to register wakeup eventfd: " +
+                   NetworkUtils::get_error_string(errno));
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (wakeup_fd >= 0) {
+        close(wakeup_fd);
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+}
+
+bool EventLoop::add_fd(int fd, uint32_t events) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        Logger::log(LogLevel::ERROR, "Failed to add fd " + std::to_string(fd) + " to epoll: " +
+                   NetworkUtils::get_error_string(errno));
+        return false;
+    }
+    return true;
+}
+
+bool EventLoop::remove_fd(int fd) {
+    return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == 0;
+}
+
+int EventLoop::wait(int* ready_fds, int max_fds, int timeout_ms) {
+    bool woken = false;
+
+    // Latency mode: non-blocking polls first, so a packet is picked up without a wakeup
+    if (busy_poll_usec > 0 && timeout_ms != 0) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(busy_poll_usec);
+        do {
+            int count = poll_events(ready_fds, max_fds, 0, woken);
+            if (count != 0 || woken) {
+                return count;
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+
+    return poll_events(ready_fds, max_fds, timeout_ms, woken);
+}
+
+int EventLoop::poll_events(int* ready_fds, int max_fds, int timeout_ms, bool& woken) {
+    struct epoll_event events[MAX_EVENTS];
+
+    int result = epoll_wait(epoll_fd, events, std::min(max_fds, MAX_EVENTS), timeout_ms);
+    if (result < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < result; i++) {
+        if (events[i].data.fd == wakeup_fd) {
+            woken = true;
+            uint64_t value;
+            ssize_t ignored = read(wakeup_fd, &value, sizeof(value));
+            (void)ignored;
+            continue;
+        }
+        ready_fds[count++] = events[i].data.fd;
+    }
+
+    return count;
+}
+
+void EventLoop::wakeup() {
+    uint64_t value = 1;
+    ssize_t ignored = write(wakeup_fd, &value, sizeof(value));
+    (void)ignored;
+}
@@ -0,0 +1,53 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "utils.h"
+#include <sys/epoll.h>
+
+// Edge-triggered epoll reactor used by the Bridge reader threads.
+// File descriptors are registered once; an eventfd lets another thread
+// wake the loop immediately (e.g. on shutdown).
+class EventLoop {
+public:
+    static const int MAX_EVENTS = 16;
+
+private:
+    int epoll_fd;
+    int wakeup_fd;
+    long busy_poll_usec;  // Latency mode: poll without blocking this long first
+
+    // One epoll_wait; woken is set if the wakeup eventfd fired
+    int poll_events(int* ready_fds, int max_fds, int timeout_ms, bool& woken);
+
+public:
+    EventLoop();
+    ~EventLoop();
+
+    // Disable copy constructor and assignment operator
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool is_valid() const { return epoll_fd >= 0 && wakeup_fd >= 0; }
+
+    // Register fd for edge-triggered readability (fd must be non-blocking)
+    bool add_fd(int fd, uint32_t events = EPOLLIN | EPOLLET);
+
+    // Unregister fd
+    bool remove_fd(int fd);
+
+    // Wait for ready fds. Returns the number stored in ready_fds,
+    // 0 on timeout or wakeup, -1 on error.
+    int wait(int* ready_fds, int max_fds, int timeout_ms = -1);
+
+    // Latency mode: busy-poll for up to usec before blocking in wait() (0: off).
+    // Set before the loop's thread starts waiting.
+    void set_busy_poll(long usec) { busy_poll_usec = usec; }
+
+    // Wake a thread blocked in wait() (thread-safe)
+    void wakeup();
+
+    // Eventfd signalled by wakeup(), for threads that wait elsewhere (io_uring)
+    int get_wakeup_fd() const { return wakeup_fd; }
+};
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,119 @@
+#include "flow_hash.h"
+#include <netinet/in.h>
+
+// Microsoft RSS verification key, the default in most NIC drivers
+static const uint8_t TOEPLITZ_KEY[FLOW_HASH_KEY_SIZE] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67,
+    0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb,
+    0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30,
+    0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+};
+
+// Bits [offset, offset + 32) of the key
+static uint32_t key_window(const uint8_t* key, size_t offset) {
+    uint32_t window = 0;
+    for (size_t i = 0; i < 32; i++) {
+        size_t bit = offset + i;
+        window = (window << 1) | ((key[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    return window;
+}
+
+FlowHasher::FlowHasher(FlowHashMode mode) : mode(FlowHashMode::NONE) {
+    set_mode(mode);
+}
+
+void FlowHasher::set_mode(FlowHashMode new_mode) {
+    mode = new_mode;
+    if (mode == FlowHashMode::NONE) {
+        return;
+    }
+
+    // A key repeating every 16 bits makes swapped addresses and ports hash alike
+    uint8_t key[FLOW_HASH_KEY_SIZE];
+    for (size_t i = 0; i < FLOW_HASH_KEY_SIZE; i++) {
+        key[i] = mode == FlowHashMode::SYMMETRIC ? TOEPLITZ_KEY[i % 2] : TOEPLITZ_KEY[i];
+    }
+
+    // Toeplitz is linear in its input bits, so each byte's share can be looked up
+    for (size_t pos = 0; pos < FLOW_HASH_INPUT_MAX; pos++) {
+        uint32_t bit_windows[8];
+        for (size_t bit = 0; bit < 8; bit++) {
+            bit_windows[bit] = key_window(key, pos * 8 + bit);
+        }
+        for (unsigned value = 0; value < 256; value++) {
+            uint32_t result = 0;
+            for (size_t bit = 0; bit < 8; bit++) {
+                if (value & (0x80 >> bit)) {
+                    result ^= bit_windows[bit];
+                }
+            }
+            table[pos][value] = result;
+        }
+    }
+}
+
+uint32_t FlowHasher::hash(const char* packet, size_t size) const {
+    if (mode == FlowHashMode::NONE || size < 1) {
+        return 0;
+    }
+
+    // Tuple in RSS order: source address, destination address, source port, destination port
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(packet);
+    const uint8_t* addresses;
+    size_t address_len;
+    const uint8_t* ports = nullptr;
+
+    uint8_t version = ip[0] >> 4;
+    if (version == 4) {
+        size_t ihl = (ip[0] & 0x0F) * 4;
+        if (size < 20 || ihl < 20 || size < ihl) {
+            return 0;
+        }
+        addresses = ip + 12;
+        address_len = 8;
+
+        // Only the first fragment has ports: hash every fragment by address alone
+        bool fragment = ((ip[6] & 0x3F) | ip[7]) != 0;
+        if (!fragment && (ip[9] == IPPROTO_TCP || ip[9] == IPPROTO_UDP) && size >= ihl + 4) {
+            ports = ip + ihl;
+        }
+    } else if (version == 6) {
+        if (size < 40) {
+            return 0;
+        }
+        addresses = ip + 8;
+        address_len = 32;
+
+        // Extension headers are not walked; such packets hash by address
+        if ((ip[6] == IPPROTO_TCP || ip[6] == IPPROTO_UDP) && size >= 44) {
+            ports = ip + 40;
+        }
+    } else {
+        return 0;
+    }
+
+    uint32_t result = 0;
+    for (size_t i = 0; i < address_len; i++) {
+        result ^= table[i][addresses[i]];
+    }
+    if (ports) {
+        for (size_t i = 0; i < 4; i++) {
+            result ^= table[address_len + i][ports[i]];
+        }
+    }
+    return result;
+}
+
+bool FlowHasher::parse_mode(const std::string& name, FlowHashMode& mode) {
+    if (name == "none") {
+        mode = FlowHashMode::NONE;
+    } else if (name == "toeplitz") {
+        mode = FlowHashMode::TOEPLITZ;
+    } else if (name == "symmetric") {
+        mode = FlowHashMode::SYMMETRIC;
+    } else {
+        return false;
+    }
+    return true;
+}
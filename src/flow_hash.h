@@ -0,0 +1,42 @@
+#ifndef FLOW_HASH_H
+#define FLOW_HASH_H
+
+#include "utils.h"
+
+// Flow hash input: IPv6 addresses plus ports, the longest tuple hashed
+#define FLOW_HASH_INPUT_MAX 36
+#define FLOW_HASH_KEY_SIZE (FLOW_HASH_INPUT_MAX + 4)
+
+enum class FlowHashMode {
+    NONE,       // No flow steering
+    TOEPLITZ,   // RSS Toeplitz hash with the standard key (direction-sensitive)
+    SYMMETRIC   // Toeplitz with a repeating 16-bit key: both directions of a flow hash alike
+};
+
+// Toeplitz hash over the IP 5-tuple, the same hash NICs use for RSS. TCP and
+// UDP packets hash addresses and ports; fragments and other protocols hash the
+// addresses only, so every packet of a flow lands on the same worker.
+// The per-key lookup tables are built once; hash() is thread-safe.
+class FlowHasher {
+private:
+    FlowHashMode mode;
+
+    // Contribution of each input byte value at each input position
+    uint32_t table[FLOW_HASH_INPUT_MAX][256];
+
+public:
+    explicit FlowHasher(FlowHashMode mode = FlowHashMode::NONE);
+
+    // Switch hash mode, rebuilding the lookup tables
+    void set_mode(FlowHashMode new_mode);
+    FlowHashMode get_mode() const { return mode; }
+    bool is_enabled() const { return mode != FlowHashMode::NONE; }
+
+    // Hash the 5-tuple of an IPv4/IPv6 packet; 0 for anything unparseable
+    uint32_t hash(const char* packet, size_t size) const;
+
+    // Parse a --flow-steering value
+    static bool parse_mode(const std::string& name, FlowHashMode& mode);
+};
+
+#endif // FLOW_HASH_H
@@ -0,0 +1,98 @@
+#include "frame_buffer.h"
+#include "crypto_manager.h"
+
+FrameBuffer::FrameBuffer(FrameFormat format, size_t capacity)
+    : buffer(capacity), read_pos(0), write_pos(0), format(format) {
+}
+
+size_t FrameBuffer::frame_length(const char* data, size_t available, bool& valid) const {
+    valid = true;
+
+    if (format == FrameFormat::ENCRYPTED) {
+        if (available < sizeof(EncryptedHeader)) {
+            return 0;
+        }
+
+        const EncryptedHeader* header = reinterpret_cast<const EncryptedHeader*>(data);
+        switch (static_cast<PacketType>(header->packet_type)) {
+            case PacketType::AUTH_REQUEST:
+            case PacketType::AUTH_RESPONSE:
+            case PacketType::AUTH_SUCCESS:
+            case PacketType::AUTH_FAILED:
+            case PacketType::AUTH_CONFIRM:
+            case PacketType::DATA_PACKET:
+            case PacketType::KEEPALIVE:
+                break;
+            default:
+                valid = false;
+                return 0;
+        }
+
+        return sizeof(EncryptedHeader) + ntohl(header->data_length);
+    }
+
+    // Raw IP: IPv4 total length or IPv6 payload length + fixed header
+    if (available < 1) {
+        return 0;
+    }
+
+    uint8_t version = (static_cast<uint8_t>(data[0]) >> 4) & 0x0F;
+    if (version == 4) {
+        if (available < 4) {
+            return 0;
+        }
+        size_t total_length = (static_cast<uint8_t>(data[2]) << 8) | static_cast<uint8_t>(data[3]);
+        valid = total_length >= 20;
+        return valid ? total_length : 0;
+    } else if (version == 6) {
+        if (available < 6) {
+            return 0;
+        }
+        return 40 + ((static_cast<uint8_t>(data[4]) << 8) | static_cast<uint8_t>(data[5]));
+    }
+
+    valid = false;
+    return 0;
+}
+
+FrameBuffer::Status FrameBuffer::next_frame(const char*& frame, size_t& frame_size) {
+    const char* data = buffer.data() + read_pos;
+    size_t available = write_pos - read_pos;
+
+    bool valid = true;
+    size_t length = frame_length(data, available, valid);
+
+    if (!valid || (length > 0 && (length > MAX_FRAME_SIZE || length > buffer.size()))) {
+        return Status::INVALID;
+    }
+
+    if (length == 0 || available < length) {
+        return Status::INCOMPLETE;
+    }
+
+    frame = data;
+    frame_size = length;
+    read_pos += length;
+
+    // Everything consumed: start the next read at the front
+    if (read_pos == write_pos) {
+        read_pos = write_pos = 0;
+    }
+
+    return Status::FRAME;
+}
+
+void FrameBuffer::compact() {
+    // Plenty of room for a full-size read: leave the partial frame where it is
+    if (read_pos == 0 || write_space() >= MAX_FRAME_SIZE) {
+        return;
+    }
+
+    // Only a partial frame (less than MAX_FRAME_SIZE) is ever moved
+    size_t remaining = write_pos - read_pos;
+    if (remaining > 0) {
+        memmove(buffer.data(), buffer.data() + read_pos, remaining);
+    }
+    read_pos = 0;
+    write_pos = remaining;
+}
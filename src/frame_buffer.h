@@ -0,0 +1,66 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include "utils.h"
+
+// Reassembly buffer sizes
+#define FRAME_BUFFER_SIZE (256 * 1024)   // Socket receive buffer (several reads worth of frames)
+#define MAX_FRAME_SIZE (64 * 1024 + 128) // Largest frame accepted from the stream
+
+// How frame boundaries are encoded on the stream
+enum class FrameFormat {
+    ENCRYPTED,  // EncryptedHeader followed by data_length bytes
+    RAW_IP      // Plain IP packets, length taken from the IP header
+};
+
+// Reassembly buffer for the TCP byte stream.
+// The socket is read in large chunks straight into the free tail of the buffer,
+// complete frames are handed out as pointers into the buffer (no copy), and a
+// trailing partial frame is carried over to the next read.
+class FrameBuffer {
+public:
+    enum class Status {
+        FRAME,       // A complete frame was returned
+        INCOMPLETE,  // More bytes are needed
+        INVALID      // Stream is out of sync (bad type or length)
+    };
+
+private:
+    std::vector<char> buffer;
+    size_t read_pos;   // Start of the first unconsumed byte
+    size_t write_pos;  // End of received data
+    FrameFormat format;
+
+    // Total size of the frame starting at data, or 0 if the header is incomplete
+    size_t frame_length(const char* data, size_t available, bool& valid) const;
+
+public:
+    explicit FrameBuffer(FrameFormat format = FrameFormat::ENCRYPTED,
+                         size_t capacity = FRAME_BUFFER_SIZE);
+
+    // Free space at the tail for the next receive
+    char* write_ptr() { return buffer.data() + write_pos; }
+    size_t write_space() const { return buffer.size() - write_pos; }
+
+    // Account for bytes received into write_ptr()
+    void commit(size_t bytes) { write_pos += bytes; }
+
+    // Slice the next complete frame out of the buffer.
+    // The returned pointer stays valid until the next compact() or reset().
+    Status next_frame(const char*& frame, size_t& frame_size);
+
+    // Move a trailing partial frame to the front once the tail gets too small
+    // for a full-size read (the move is bounded by MAX_FRAME_SIZE)
+    void compact();
+
+    // Drop all buffered data
+    void reset() { read_pos = write_pos = 0; }
+
+    size_t buffered() const { return write_pos - read_pos; }
+
+    // Whole backing store (for registering with io_uring)
+    char* data() { return buffer.data(); }
+    size_t capacity() const { return buffer.size(); }
+};
+
+#endif // FRAME_BUFFER_H
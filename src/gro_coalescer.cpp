@@ -0,0 +1,236 @@
+#include "gro_coalescer.h"
+#include <netinet/in.h>
+#include <endian.h>
+
+#define TCP_FLAG_PSH 0x08
+#define TCP_FLAG_ACK 0x10
+
+static uint16_t load_be16(const uint8_t* field) {
+    return (static_cast<uint16_t>(field[0]) << 8) | field[1];
+}
+
+static void store_be16(uint8_t* field, uint16_t value) {
+    field[0] = value >> 8;
+    field[1] = value & 0xFF;
+}
+
+static uint32_t load_be32(const uint8_t* field) {
+    return (static_cast<uint32_t>(load_be16(field)) << 16) | load_be16(field + 2);
+}
+
+GroCoalescer::GroCoalescer(Output output) : active_flows(0), output(output) {
+}
+
+GroFlow* GroCoalescer::find_flow(const uint8_t* packet, bool ipv4, size_t l4_offset) {
+    if (active_flows == 0) {
+        return nullptr;
+    }
+
+    size_t addr_offset = ipv4 ? 12 : 8;
+    size_t addr_size = ipv4 ? 8 : 32;
+    for (GroFlow& flow : flows) {
+        if (!flow.active || flow.ipv4 != ipv4) {
+            continue;
+        }
+        const uint8_t* held = reinterpret_cast<const uint8_t*>(flow.packet.data());
+        if (memcmp(held + addr_offset, packet + addr_offset, addr_size) == 0 &&
+            memcmp(held + flow.l4_offset, packet + l4_offset, 4) == 0) {
+            return &flow;
+        }
+    }
+    return nullptr;
+}
+
+bool GroCoalescer::can_merge(const GroFlow& flow, const uint8_t* packet, size_t size,
+                             size_t payload_size) const {
+    const uint8_t* held = reinterpret_cast<const uint8_t*>(flow.packet.data());
+    const uint8_t* tcp = packet + flow.l4_offset;
+    const uint8_t* held_tcp = held + flow.l4_offset;
+
+    if (size - payload_size != flow.headers_size || payload_size > flow.mss ||
+        flow.packet.size() + payload_size > GSO_MAX_PACKET_SIZE ||
+        load_be32(tcp + 4) != flow.next_seq) {
+        return false;
+    }
+
+    // IP: everything but length, ID and checksum must match
+    if (flow.ipv4) {
+        if (memcmp(held, packet, 2) != 0 || memcmp(held + 6, packet + 6, 4) != 0) {
+            return false;
+        }
+    } else if (memcmp(held, packet, 4) != 0 || memcmp(held + 6, packet + 6, 2) != 0) {
+        return false;
+    }
+
+    // TCP: same ACK, window and options; only PSH may differ
+    return memcmp(held_tcp + 8, tcp + 8, 5) == 0 &&
+           ((held_tcp[13] ^ tcp[13]) & ~TCP_FLAG_PSH) == 0 &&
+           memcmp(held_tcp + 14, tcp + 14, 2) == 0 &&
+           memcmp(held_tcp + 18, tcp + 18, flow.headers_size - flow.l4_offset - 18) == 0;
+}
+
+void GroCoalescer::start_flow(GroFlow& flow, const uint8_t* packet, size_t size, bool ipv4,
+                              size_t l4_offset, size_t headers_size) {
+    // assign() keeps the capacity from earlier flows
+    flow.packet.assign(reinterpret_cast<const char*>(packet), reinterpret_cast<const char*>(packet) + size);
+    flow.l4_offset = l4_offset;
+    flow.headers_size = headers_size;
+    flow.mss = size - headers_size;
+    flow.segments = 1;
+    flow.next_seq = load_be32(packet + l4_offset + 4) + static_cast<uint32_t>(flow.mss);
+    flow.ipv4 = ipv4;
+    flow.active = true;
+    flow.started = std::chrono::steady_clock::now();
+    active_flows++;
+}
+
+void GroCoalescer::flush_flow(GroFlow& flow) {
+    if (!flow.active) {
+        return;
+    }
+    flow.active = false;
+    active_flows--;
+
+    if (flow.segments == 1) {
+        // Nothing merged: the original segment goes out untouched
+        output(nullptr, flow.packet.data(), flow.packet.size());
+        return;
+    }
+
+    uint8_t* packet = reinterpret_cast<uint8_t*>(flow.packet.data());
+    size_t size = flow.packet.size();
+    if (flow.ipv4) {
+        store_be16(packet + 2, static_cast<uint16_t>(size));
+        store_be16(packet + 10, 0);
+        store_be16(packet + 10, GsoSegmenter::checksum_fold(GsoSegmenter::checksum_add(packet, flow.l4_offset)));
+    } else {
+        store_be16(packet + 4, static_cast<uint16_t>(size - 40));
+    }
+
+    // Partial checksum: the field holds the pseudo-header sum and the kernel
+    // treats the packet as locally generated (the tunnel already authenticated it)
+    size_t l4_size = size - flow.l4_offset;
+    uint16_t pseudo = ~GsoSegmenter::checksum_fold(GsoSegmenter::pseudo_header_sum(packet, IPPROTO_TCP, l4_size));
+    store_be16(packet + flow.l4_offset + 16, pseudo);
+
+    VnetHdr hdr;
+    hdr.flags = VNET_HDR_F_NEEDS_CSUM;
+    hdr.gso_type = flow.ipv4 ? VNET_HDR_GSO_TCPV4 : VNET_HDR_GSO_TCPV6;
+    hdr.hdr_len = htole16(static_cast<uint16_t>(flow.headers_size));
+    hdr.gso_size = htole16(static_cast<uint16_t>(flow.mss));
+    hdr.csum_start = htole16(static_cast<uint16_t>(flow.l4_offset));
+    hdr.csum_offset = htole16(16);
+
+    output(&hdr, flow.packet.data(), size);
+}
+
+bool GroCoalescer::add(const char* buffer, size_t size) {
+    const uint8_t* packet = reinterpret_cast<const uint8_t*>(buffer);
+    if (size < 20) {
+        return false;
+    }
+
+    bool ipv4;
+    size_t l4_offset;
+    bool plain_ip;  // No options, fragments or extension headers
+    uint8_t version = packet[0] >> 4;
+    if (version == 4) {
+        if (packet[9] != IPPROTO_TCP) {
+            return false;
+        }
+        ipv4 = true;
+        l4_offset = (packet[0] & 0x0F) * 4;
+        plain_ip = l4_offset == 20 && (load_be16(packet + 6) & 0x3FFF) == 0 &&
+                   load_be16(packet + 2) == size;
+    } else if (version == 6) {
+        if (size < 40 || packet[6] != IPPROTO_TCP) {
+            return false;
+        }
+        ipv4 = false;
+        l4_offset = 40;
+        plain_ip = load_be16(packet + 4) + 40u == size;
+    } else {
+        return false;
+    }
+
+    if (l4_offset < 20 || size < l4_offset + 20) {
+        return false;
+    }
+    size_t headers_size = l4_offset + (packet[l4_offset + 12] >> 4) * 4;
+    if (headers_size < l4_offset + 20 || headers_size > size) {
+        return false;
+    }
+    size_t payload_size = size - headers_size;
+    uint8_t flags = packet[l4_offset + 13];
+
+    GroFlow* flow = find_flow(packet, ipv4, l4_offset);
+
+    // Only plain data segments (ACK, optionally PSH) are merged;
+    // anything else first releases what is held for its flow
+    bool mergeable = plain_ip && payload_size > 0 && (flags & TCP_FLAG_ACK) &&
+                     (flags & ~(TCP_FLAG_ACK | TCP_FLAG_PSH)) == 0;
+    if (!mergeable) {
+        if (flow) {
+            flush_flow(*flow);
+        }
+        return false;
+    }
+
+    if (flow) {
+        if (can_merge(*flow, packet, size, payload_size)) {
+            flow->packet.insert(flow->packet.end(), buffer + headers_size, buffer + size);
+            flow->next_seq += static_cast<uint32_t>(payload_size);
+            flow->segments++;
+            if (flags & TCP_FLAG_PSH) {
+                flow->packet[flow->l4_offset + 13] |= TCP_FLAG_PSH;
+            }
+
+            // A short or pushed segment ends the burst
+            if (payload_size < flow->mss || (flags & TCP_FLAG_PSH) ||
+                flow->segments >= GRO_MAX_SEGMENTS) {
+                flush_flow(*flow);
+            }
+            return true;
+        }
+        flush_flow(*flow);
+    }
+
+    if (flags & TCP_FLAG_PSH) {
+        return false;  // Nothing can follow it
+    }
+
+    // Free slot, or evict the oldest flow
+    GroFlow* slot = nullptr;
+    for (GroFlow& candidate : flows) {
+        if (!candidate.active) {
+            slot = &candidate;
+            break;
+        }
+        if (!slot || candidate.started < slot->started) {
+            slot = &candidate;
+        }
+    }
+    flush_flow(*slot);
+
+    start_flow(*slot, packet, size, ipv4, l4_offset, headers_size);
+    return true;
+}
+
+void GroCoalescer::flush() {
+    for (GroFlow& flow : flows) {
+        flush_flow(flow);
+    }
+}
+
+void GroCoalescer::flush_expired() {
+    if (active_flows == 0) {
+        return;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::microseconds(GRO_FLUSH_USEC);
+    for (GroFlow& flow : flows) {
+        if (flow.active && flow.started <= deadline) {
+            flush_flow(flow);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef GRO_COALESCER_H
+#define GRO_COALESCER_H
+
+#include "utils.h"
+#include "gso_segmenter.h"
+#include <functional>
+
+// GRO settings
+#define GRO_MAX_FLOWS 8          // Flows held open at once per decrypt thread
+#define GRO_MAX_SEGMENTS 64      // Segments merged into one super-packet
+#define GRO_FLUSH_USEC 50        // Longest a segment waits for its successor
+
+// One TCP flow being merged: headers of the first segment followed by the
+// payloads of all in-order segments received so far
+struct GroFlow {
+    std::vector<char> packet;
+    size_t l4_offset;
+    size_t headers_size;
+    size_t mss;            // Payload size of the first segment
+    size_t segments;
+    uint32_t next_seq;
+    bool ipv4;
+    bool active;
+    std::chrono::steady_clock::time_point started;
+
+    GroFlow() : l4_offset(0), headers_size(0), mss(0), segments(0), next_seq(0),
+                ipv4(false), active(false) {}
+};
+
+// Receive offload for the TUN write side (offload mode only).
+// Consecutive in-order TCP segments of a flow are merged into one GSO
+// super-packet and written with a single virtio_net_hdr write, so the kernel
+// runs its stack once per super-packet instead of once per segment.
+// Not thread-safe: each decrypt thread owns its coalescer.
+class GroCoalescer {
+public:
+    // Receives finished packets; hdr is null for a segment that was not merged
+    typedef std::function<bool(const VnetHdr* hdr, const char* packet, size_t size)> Output;
+
+private:
+    GroFlow flows[GRO_MAX_FLOWS];
+    size_t active_flows;
+    Output output;
+
+    // Flow holding the same addresses and ports, or nullptr
+    GroFlow* find_flow(const uint8_t* packet, bool ipv4, size_t l4_offset);
+
+    // Whether a segment continues a flow (same headers, next sequence number)
+    bool can_merge(const GroFlow& flow, const uint8_t* packet, size_t size, size_t payload_size) const;
+
+    void start_flow(GroFlow& flow, const uint8_t* packet, size_t size, bool ipv4,
+                    size_t l4_offset, size_t headers_size);
+    void flush_flow(GroFlow& flow);
+
+public:
+    explicit GroCoalescer(Output output);
+
+    // Disable copy constructor and assignment operator
+    GroCoalescer(const GroCoalescer&) = delete;
+    GroCoalescer& operator=(const GroCoalescer&) = delete;
+
+    // Take an IP packet. Returns false if it cannot be merged; the caller then
+    // writes it itself (anything held for the same flow has been flushed first).
+    bool add(const char* packet, size_t size);
+
+    // Write out every held flow
+    void flush();
+
+    // Write out flows that have waited longer than GRO_FLUSH_USEC
+    void flush_expired();
+
+    bool has_pending() const { return active_flows > 0; }
+};
+
+#endif // GRO_COALESCER_H
@@ -0,0 +1,151 @@
+#include "gso_segmenter.h"
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <endian.h>
+#include <algorithm>
+
+// TCP flags that may only appear on the first / last segment
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_PSH 0x08
+#define TCP_FLAG_CWR 0x80
+
+uint32_t GsoSegmenter::checksum_add(const uint8_t* data, size_t len, uint32_t sum) {
+    while (len > 1) {
+        sum += (static_cast<uint32_t>(data[0]) << 8) | data[1];
+        data += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        sum += static_cast<uint32_t>(data[0]) << 8;
+    }
+    return sum;
+}
+
+uint16_t GsoSegmenter::checksum_fold(uint32_t sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+uint32_t GsoSegmenter::pseudo_header_sum(const uint8_t* ip, uint8_t protocol, size_t l4_len) {
+    uint32_t sum = protocol;
+    if ((ip[0] >> 4) == 4) {
+        sum = checksum_add(ip + 12, 8, sum);  // Source and destination address
+    } else {
+        sum = checksum_add(ip + 8, 32, sum);
+    }
+    sum += static_cast<uint32_t>(l4_len >> 16) + static_cast<uint32_t>(l4_len & 0xFFFF);
+    return sum;
+}
+
+static void store_be16(uint8_t* field, uint16_t value) {
+    field[0] = value >> 8;
+    field[1] = value & 0xFF;
+}
+
+bool GsoSegmenter::finish_checksum(const VnetHdr& hdr, char* packet, size_t size) {
+    size_t start = le16toh(hdr.csum_start);
+    size_t offset = le16toh(hdr.csum_offset);
+    if (start + offset + 2 > size) {
+        return false;
+    }
+
+    // The checksum field already holds the pseudo-header sum
+    uint8_t* data = reinterpret_cast<uint8_t*>(packet);
+    uint16_t checksum = checksum_fold(checksum_add(data + start, size - start));
+    if (checksum == 0 && offset == 6) {
+        checksum = 0xFFFF;  // UDP reserves zero for "no checksum"
+    }
+    store_be16(data + start + offset, checksum);
+    return true;
+}
+
+bool GsoSegmenter::segment(const VnetHdr& hdr, const char* packet, size_t size,
+                           std::vector<std::vector<char>>& segments) {
+    uint8_t gso_type = hdr.gso_type & ~VNET_HDR_GSO_ECN;
+    if (gso_type == VNET_HDR_GSO_NONE) {
+        segments.emplace_back(packet, packet + size);
+        if (hdr.flags & VNET_HDR_F_NEEDS_CSUM) {
+            return finish_checksum(hdr, segments.back().data(), size);
+        }
+        return true;
+    }
+
+    // Locate the TCP header ourselves rather than trusting hdr_len
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(packet);
+    size_t l4_offset;
+    bool ipv4 = gso_type == VNET_HDR_GSO_TCPV4;
+    if (ipv4) {
+        if (size < 20 || (data[0] >> 4) != 4 || data[9] != IPPROTO_TCP) {
+            return false;
+        }
+        l4_offset = (data[0] & 0x0F) * 4;
+    } else if (gso_type == VNET_HDR_GSO_TCPV6) {
+        // Extension headers are not segmented; the kernel rarely emits them for TSO
+        if (size < 40 || (data[0] >> 4) != 6 || data[6] != IPPROTO_TCP) {
+            return false;
+        }
+        l4_offset = 40;
+    } else {
+        return false;
+    }
+
+    if (l4_offset < 20 || size < l4_offset + 20) {
+        return false;
+    }
+    size_t tcp_header_size = (data[l4_offset + 12] >> 4) * 4;
+    size_t headers_size = l4_offset + tcp_header_size;
+    size_t mss = le16toh(hdr.gso_size);
+    if (tcp_header_size < 20 || headers_size > size || mss == 0) {
+        return false;
+    }
+
+    size_t payload_size = size - headers_size;
+    uint32_t seq;
+    memcpy(&seq, data + l4_offset + 4, sizeof(seq));
+    seq = ntohl(seq);
+    uint16_t ip_id = ipv4 ? (static_cast<uint16_t>(data[4]) << 8) | data[5] : 0;
+
+    segments.reserve(segments.size() + (payload_size + mss - 1) / mss);
+    for (size_t offset = 0, index = 0; ; offset += mss, index++) {
+        size_t chunk = std::min(mss, payload_size - offset);
+        bool first = offset == 0;
+        bool last = offset + chunk >= payload_size;
+
+        segments.emplace_back(headers_size + chunk);
+        uint8_t* seg = reinterpret_cast<uint8_t*>(segments.back().data());
+        memcpy(seg, data, headers_size);
+        memcpy(seg + headers_size, data + headers_size + offset, chunk);
+
+        // IP header: length, ID and (v4) header checksum
+        if (ipv4) {
+            store_be16(seg + 2, static_cast<uint16_t>(headers_size + chunk));
+            store_be16(seg + 4, static_cast<uint16_t>(ip_id + index));
+            store_be16(seg + 10, 0);
+            store_be16(seg + 10, checksum_fold(checksum_add(seg, l4_offset)));
+        } else {
+            store_be16(seg + 4, static_cast<uint16_t>(headers_size + chunk - 40));
+        }
+
+        // TCP header: sequence number, per-segment flags and full checksum
+        uint8_t* tcp = seg + l4_offset;
+        uint32_t seg_seq = htonl(seq + static_cast<uint32_t>(offset));
+        memcpy(tcp + 4, &seg_seq, sizeof(seg_seq));
+        if (!last) {
+            tcp[13] &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+        }
+        if (!first) {
+            tcp[13] &= ~TCP_FLAG_CWR;
+        }
+        store_be16(tcp + 16, 0);
+        uint32_t sum = pseudo_header_sum(seg, IPPROTO_TCP, tcp_header_size + chunk);
+        store_be16(tcp + 16, checksum_fold(checksum_add(tcp, tcp_header_size + chunk, sum)));
+
+        if (last) {
+            break;
+        }
+    }
+
+    return true;
+}
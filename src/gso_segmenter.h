@@ -0,0 +1,51 @@
+#ifndef GSO_SEGMENTER_H
+#define GSO_SEGMENTER_H
+
+#include "utils.h"
+
+// struct virtio_net_hdr from <linux/virtio_net.h>, which does not compile as C++
+struct VnetHdr {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+};
+
+#define VNET_HDR_F_NEEDS_CSUM 0x01
+#define VNET_HDR_GSO_NONE 0x00
+#define VNET_HDR_GSO_TCPV4 0x01
+#define VNET_HDR_GSO_TCPV6 0x04
+#define VNET_HDR_GSO_ECN 0x80
+
+// TUN offload mode (IFF_VNET_HDR): every packet on the TUN fd is preceded by a
+// VnetHdr, and TCP packets may be GSO super-packets of up to 64 KB
+#define VNET_HDR_SIZE sizeof(VnetHdr)
+#define GSO_MAX_PACKET_SIZE 65535
+#define TUN_OFFLOAD_READ_SIZE (VNET_HDR_SIZE + GSO_MAX_PACKET_SIZE)
+
+// Software fallback for GSO super-packets, used when the side that has to put
+// them on the wire (or into a TUN without offload) cannot pass them through.
+// Header fields are little-endian (TUNSETVNETLE), which is also the wire format.
+class GsoSegmenter {
+public:
+    // Split a TCPv4/TCPv6 super-packet into gso_size segments with fixed-up
+    // IP/TCP headers and full checksums. Non-GSO packets with a partial
+    // checksum are completed and returned as a single segment.
+    // Returns false if the header does not describe the packet.
+    static bool segment(const VnetHdr& hdr, const char* packet, size_t size,
+                        std::vector<std::vector<char>>& segments);
+
+    // Fold the partial checksum a NEEDS_CSUM packet carries into the final one
+    static bool finish_checksum(const VnetHdr& hdr, char* packet, size_t size);
+
+    // Internet checksum helpers (RFC 1071)
+    static uint32_t checksum_add(const uint8_t* data, size_t len, uint32_t sum = 0);
+    static uint16_t checksum_fold(uint32_t sum);
+
+    // Pseudo-header sum for an L4 segment of l4_len bytes (protocol from the IP header)
+    static uint32_t pseudo_header_sum(const uint8_t* ip, uint8_t protocol, size_t l4_len);
+};
+
+#endif // GSO_SEGMENTER_H
@@ -8,6 +8,7 @@
 #include <signal.h>
 #include <getopt.h>
 #include <fstream>
+#include <algorithm>
 
 // Global objects for signal handling
 TunManager* g_tun_manager = nullptr;
@@ -47,13 +48,35 @@ void print_usage(const char* program_name) {
     std::cout << "Options:\n";
     std::cout << "  --mode MODE         Operation mode: 'client' or 'server' (required)\n";
     std::cout << "  --dev DEVICE        TUN device name (default: tun0)\n";
-    std::cout << "  --port PORT         TCP port (default: 51860)\n";
+    std::cout << "  --port PORT         TCP/UDP port (default: 51860)\n";
     std::cout << "  --remote-ip IP      Remote server IP (required for client mode)\n";
     std::cout << "  --local-tun-ip IP   Local TUN IP address (required)\n";
     std::cout << "  --remote-tun-ip IP  Remote TUN IP address (required)\n";
     std::cout << "  --psk KEY           Pre-shared key for encryption (required)\n";
     std::cout << "  --psk-file FILE     Read pre-shared key from file\n";
     std::cout << "  --no-encryption     Disable encryption (for performance testing)\n";
+    std::cout << "  --cipher SUITE      Data cipher: 'auto' (faster one by startup benchmark), 'aes-256-gcm'\n";
+    std::cout << "                      or 'chacha20-poly1305' (default: auto, negotiated with the peer;\n";
+    std::cout << "                      a configured suite beats auto, and on a conflict the server's wins\n";
+    std::cout << "                      and the client refuses to connect)\n";
+    std::cout << "  --rekey-interval N  Switch to a new data key every N seconds, 0 disables (default: 3600)\n";
+    std::cout << "  --rekey-packets N   ... or after N packets under one key, 0 disables (default: 4294967296)\n";
+    std::cout << "  --transport PROTO   Tunnel transport: 'tcp' or 'udp' (default: tcp)\n";
+    std::cout << "  --multi-queue       Open one TUN queue and pipeline per CPU core\n";
+    std::cout << "  --tun-queues N      Number of TUN queues (implies --multi-queue)\n";
+    std::cout << "  --io-engine ENGINE  Data path I/O engine: 'epoll' or 'uring' (default: epoll)\n";
+    std::cout << "  --tun-offload       Enable TSO/GSO on the TUN device (64 KB super-packets)\n";
+    std::cout << "  --tx-batch N        Frames per socket send batch (default: 64)\n";
+    std::cout << "  --tx-batch-bytes N  Bytes per socket send batch (default: 262144)\n";
+    std::cout << "  --tx-flush-usec N   Wait up to N us for more frames before sending (default: 0)\n";
+    std::cout << "  --zerocopy-threshold N  Use MSG_ZEROCOPY for TCP sends of N bytes or more, 0 disables (default: 32768)\n";
+    std::cout << "  --crypto-workers N  Encrypt/decrypt on N threads per pipeline, released in order (default: 0, inline)\n";
+    std::cout << "  --flow-steering MODE  Steer TUN packets to crypto workers by flow: 'none', 'toeplitz'\n";
+    std::cout << "                      or 'symmetric' (default: none, round robin with reordering)\n";
+    std::cout << "  --cpu-affinity SPEC Pin thread roles to CPUs, e.g. 'tun=0-1;socket=2;encrypt=3;decrypt=4;\n";
+    std::cout << "                      crypto=5-8;heartbeat=0' (buffers follow the CPUs' NUMA node)\n";
+    std::cout << "  --latency-mode      Busy-poll the TUN, socket and crypto threads before sleeping\n";
+    std::cout << "  --spin-budget USEC  Latency mode: busy-poll up to USEC before blocking (default: 50)\n";
     std::cout << "  --log-level LEVEL   Log level: debug, info, warning, error (default: info)\n";
     std::cout << "  --help              Show this help message\n\n";
     std::cout << "Examples:\n";
@@ -82,13 +105,30 @@ bool parse_arguments(int argc, char* argv[], MainConfig& config) {
         {"psk", required_argument, 0, 'k'},
         {"psk-file", required_argument, 0, 'f'},
         {"no-encryption", no_argument, 0, 'n'},
+        {"cipher", required_argument, 0, 'C'},
+        {"rekey-interval", required_argument, 0, 'R'},
+        {"rekey-packets", required_argument, 0, 'K'},
+        {"transport", required_argument, 0, 'T'},
+        {"multi-queue", no_argument, 0, 'Q'},
+        {"tun-queues", required_argument, 0, 'q'},
+        {"io-engine", required_argument, 0, 'e'},
+        {"tun-offload", no_argument, 0, 'O'},
+        {"tx-batch", required_argument, 0, 'B'},
+        {"tx-batch-bytes", required_argument, 0, 'Y'},
+        {"tx-flush-usec", required_argument, 0, 'U'},
+        {"zerocopy-threshold", required_argument, 0, 'Z'},
+        {"crypto-workers", required_argument, 0, 'W'},
+        {"flow-steering", required_argument, 0, 'S'},
+        {"cpu-affinity", required_argument, 0, 'A'},
+        {"latency-mode", no_argument, 0, 'L'},
+        {"spin-budget", required_argument, 0, 'P'},
         {"log-level", required_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     int c;
-    while ((c = getopt_long(argc, argv, "m:d:p:r:l:t:k:f:nv:h", long_options, nullptr)) != -1) {
+    while ((c = getopt_long(argc, argv, "m:d:p:r:l:t:k:f:nC:R:K:T:Qq:e:OB:Y:U:Z:W:S:A:LP:v:h", long_options, nullptr)) != -1) {
         switch (c) {
             case 'm':
                 config.mode = optarg;
@@ -127,6 +167,57 @@ bool parse_arguments(int argc, char* argv[], MainConfig& config) {
             case 'n':
                 config.enable_encryption = false;
                 break;
+            case 'C':
+                config.cipher = optarg;
+                break;
+            case 'R':
+                config.rekey_interval = std::stoi(optarg);
+                break;
+            case 'K':
+                config.rekey_packets = std::stoll(optarg);
+                break;
+            case 'T':
+                config.transport = optarg;
+                break;
+            case 'Q':
+                config.tun_queues = std::max(1u, std::thread::hardware_concurrency());
+                break;
+            case 'q':
+                config.tun_queues = std::stoi(optarg);
+                break;
+            case 'e':
+                config.io_engine = optarg;
+                break;
+            case 'O':
+                config.tun_offload = true;
+                break;
+            case 'B':
+                config.tx_batch_frames = std::stoi(optarg);
+                break;
+            case 'Y':
+                config.tx_batch_bytes = std::stoi(optarg);
+                break;
+            case 'U':
+                config.tx_flush_usec = std::stoi(optarg);
+                break;
+            case 'Z':
+                config.zerocopy_threshold = std::stoi(optarg);
+                break;
+            case 'W':
+                config.crypto_workers = std::stoi(optarg);
+                break;
+            case 'S':
+                config.flow_steering = optarg;
+                break;
+            case 'A':
+                config.cpu_affinity = optarg;
+                break;
+            case 'L':
+                config.latency_mode = true;
+                break;
+            case 'P':
+                config.spin_budget_usec = std::stoi(optarg);
+                break;
             case 'v':
                 config.log_level = optarg;
                 break;
@@ -167,6 +258,70 @@ bool validate_config(const MainConfig& config) {
         return false;
     }
     
+    if (config.transport != "tcp" && config.transport != "udp") {
+        std::cerr << "Error: Transport must be 'tcp' or 'udp'" << std::endl;
+        return false;
+    }
+    
+    if (config.tun_queues < 1 || config.tun_queues > MAX_TUN_QUEUES) {
+        std::cerr << "Error: TUN queues must be between 1 and " << MAX_TUN_QUEUES << std::endl;
+        return false;
+    }
+    
+    if (config.tx_batch_frames < 1 || config.tx_batch_frames > TX_MAX_BATCH_FRAMES) {
+        std::cerr << "Error: TX batch must be between 1 and " << TX_MAX_BATCH_FRAMES << " frames" << std::endl;
+        return false;
+    }
+    
+    if (config.tx_batch_bytes < 1 || config.tx_flush_usec < 0 || config.tx_flush_usec > 10000) {
+        std::cerr << "Error: TX batch bytes must be positive and flush deadline 0-10000 us" << std::endl;
+        return false;
+    }
+    
+    if (config.zerocopy_threshold < 0) {
+        std::cerr << "Error: Zero-copy threshold must not be negative" << std::endl;
+        return false;
+    }
+    
+    if (config.crypto_workers < 0 || config.crypto_workers > CRYPTO_MAX_WORKERS) {
+        std::cerr << "Error: Crypto workers must be between 0 and " << CRYPTO_MAX_WORKERS << std::endl;
+        return false;
+    }
+    
+    FlowHashMode flow_mode;
+    if (!FlowHasher::parse_mode(config.flow_steering, flow_mode)) {
+        std::cerr << "Error: Flow steering must be 'none', 'toeplitz' or 'symmetric'" << std::endl;
+        return false;
+    }
+    
+    ThreadPlacement placement;
+    std::string placement_error;
+    if (!placement.parse(config.cpu_affinity, placement_error)) {
+        std::cerr << "Error: CPU affinity: " << placement_error << std::endl;
+        return false;
+    }
+    
+    CipherSuite suite;
+    if (!CryptoManager::parse_suite(config.cipher, suite)) {
+        std::cerr << "Error: Cipher must be 'auto', 'aes-256-gcm' or 'chacha20-poly1305'" << std::endl;
+        return false;
+    }
+    
+    if (config.spin_budget_usec < 0 || config.spin_budget_usec > 100000) {
+        std::cerr << "Error: Spin budget must be between 0 and 100000 microseconds" << std::endl;
+        return false;
+    }
+    
+    if (config.rekey_interval < 0 || config.rekey_packets < 0) {
+        std::cerr << "Error: Rekey interval and packet limit must not be negative" << std::endl;
+        return false;
+    }
+    
+    if (config.io_engine != "epoll" && config.io_engine != "uring") {
+        std::cerr << "Error: I/O engine must be 'epoll' or 'uring'" << std::endl;
+        return false;
+    }
+    
     return true;
 }
 
@@ -177,7 +332,25 @@ void print_config(const MainConfig& config) {
     Logger::log(LogLevel::INFO, "Port: " + std::to_string(config.port));
     Logger::log(LogLevel::INFO, "Local TUN IP: " + config.local_tun_ip);
     Logger::log(LogLevel::INFO, "Remote TUN IP: " + config.remote_tun_ip);
-    Logger::log(LogLevel::INFO, "Encryption: " + std::string(config.enable_encryption ? "Enabled" : "Disabled"));
+    Logger::log(LogLevel::INFO, "Encryption: " + (config.enable_encryption ? "Enabled, cipher " + config.cipher : std::string("Disabled")));
+    if (config.enable_encryption) {
+        Logger::log(LogLevel::INFO, "Rekey: every " + std::to_string(config.rekey_interval) + " s or " +
+                   std::to_string(config.rekey_packets) + " packets (0 = never)");
+    }
+    Logger::log(LogLevel::INFO, "Transport: " + config.transport);
+    Logger::log(LogLevel::INFO, "TUN queues: " + std::to_string(config.tun_queues));
+    Logger::log(LogLevel::INFO, "I/O engine: " + config.io_engine);
+    Logger::log(LogLevel::INFO, "TUN offload: " + std::string(config.tun_offload ? "Enabled" : "Disabled"));
+    Logger::log(LogLevel::INFO, "TX batch: " + std::to_string(config.tx_batch_frames) + " frames, " +
+               std::to_string(config.tx_batch_bytes) + " bytes, " + std::to_string(config.tx_flush_usec) + " us");
+    Logger::log(LogLevel::INFO, "Zero-copy threshold: " + (config.zerocopy_threshold > 0 ? 
+               std::to_string(config.zerocopy_threshold) + " bytes" : std::string("Disabled")));
+    Logger::log(LogLevel::INFO, "Crypto workers: " + (config.crypto_workers > 0 ? 
+               std::to_string(config.crypto_workers) + " per pipeline" : std::string("Inline")));
+    Logger::log(LogLevel::INFO, "Flow steering: " + config.flow_steering);
+    Logger::log(LogLevel::INFO, "CPU affinity: " + (config.cpu_affinity.empty() ? std::string("None") : config.cpu_affinity));
+    Logger::log(LogLevel::INFO, "Latency mode: " + (config.latency_mode ? 
+               "Enabled, " + std::to_string(config.spin_budget_usec) + " us spin budget" : std::string("Disabled")));
     
     if (config.mode == "client") {
         Logger::log(LogLevel::INFO, "Remote Server: " + config.remote_ip + ":" + std::to_string(config.port));
@@ -233,13 +406,14 @@ int main(int argc, char* argv[]) {
     g_tun_manager = &tun_manager;
     
     // Create TUN interface
-    if (!tun_manager.create_tun(config.dev_name)) {
+    if (!tun_manager.create_tun(config.dev_name, config.tun_queues, config.tun_offload)) {
         Logger::log(LogLevel::ERROR, "Failed to create TUN interface");
         return 1;
     }
     
-    // Configure TUN interface
-    if (!tun_manager.configure_interface(config.local_tun_ip, config.remote_tun_ip)) {
+    // Configure TUN interface (a UDP datagram must fit the path MTU whole)
+    int tun_mtu = config.transport == "udp" ? UDP_TUN_MTU : config.tun_mtu;
+    if (!tun_manager.configure_interface(config.local_tun_ip, config.remote_tun_ip, config.netmask, tun_mtu)) {
         Logger::log(LogLevel::ERROR, "Failed to configure TUN interface");
         return 1;
     }
@@ -247,6 +421,10 @@ int main(int argc, char* argv[]) {
     // Create socket manager
     SocketManager socket_manager;
     g_socket_manager = &socket_manager;
+    socket_manager.set_transport(config.transport == "udp" ? Transport::UDP : Transport::TCP);
+    if (config.latency_mode) {
+        socket_manager.set_busy_poll(config.spin_budget_usec);
+    }
     
     // Create crypto manager
     CryptoManager crypto_manager;
@@ -258,10 +436,13 @@ int main(int argc, char* argv[]) {
     
     // Initialize encryption if enabled
     if (config.enable_encryption) {
-        if (!crypto_manager.initialize(config.psk)) {
+        CipherSuite suite = CipherSuite::AUTO;
+        CryptoManager::parse_suite(config.cipher, suite);
+        if (!crypto_manager.initialize(config.psk, suite)) {
             Logger::log(LogLevel::ERROR, "Failed to initialize encryption");
             return 1;
         }
+        crypto_manager.set_rekey_policy(config.rekey_interval, config.rekey_packets);
         Logger::log(LogLevel::INFO, "Encryption initialized");
     } else {
         Logger::log(LogLevel::WARNING, "Running without encryption - for performance testing only");
@@ -290,7 +471,9 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
-        Logger::log(LogLevel::INFO, "Client connected: " + socket_manager.get_remote_endpoint());
+        if (!socket_manager.is_datagram()) {
+            Logger::log(LogLevel::INFO, "Client connected: " + socket_manager.get_remote_endpoint());
+        }
         connection_ready = true;
         
     } else { // client mode
@@ -330,6 +513,32 @@ int main(int argc, char* argv[]) {
     
     // Initialize and start bridge
     bridge.initialize(config.mode, config.remote_ip, config.port);
+    bridge.set_io_engine(config.io_engine == "uring" ? IoEngine::IO_URING : IoEngine::EPOLL);
+    
+    TxFlushPolicy tx_policy;
+    tx_policy.max_frames = config.tx_batch_frames;
+    tx_policy.max_bytes = config.tx_batch_bytes;
+    tx_policy.flush_usec = config.tx_flush_usec;
+    tx_policy.zerocopy_bytes = config.zerocopy_threshold;
+    if (config.zerocopy_threshold > 0 && !socket_manager.is_datagram()) {
+        socket_manager.enable_zerocopy();
+    }
+    bridge.set_tx_flush_policy(tx_policy);
+    bridge.set_crypto_workers(config.crypto_workers);
+    FlowHashMode flow_mode = FlowHashMode::NONE;
+    FlowHasher::parse_mode(config.flow_steering, flow_mode);
+    bridge.set_flow_steering(flow_mode);
+    ThreadPlacement placement;
+    std::string placement_error;
+    placement.parse(config.cpu_affinity, placement_error);
+    bridge.set_thread_placement(placement);
+    if (config.latency_mode) {
+        // A spinning thread holds its CPU; without one per thread it only delays the others
+        if (std::thread::hardware_concurrency() <= 1) {
+            Logger::log(LogLevel::WARNING, "Latency mode on a single CPU: spinning threads delay each other");
+        }
+        bridge.set_latency_mode(config.spin_budget_usec);
+    }
     
     if (!bridge.start()) {
         Logger::log(LogLevel::ERROR, "Failed to start bridge");
@@ -0,0 +1,208 @@
+#include "packet_pool.h"
+#include <cstdlib>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+// Free buffers a thread holds, per size class. Given back when the thread exits.
+struct PacketThreadCache {
+    PacketPool* pool;
+    std::vector<PacketBuffer*> free_lists[PacketPool::SIZE_CLASSES];
+
+    PacketThreadCache() : pool(nullptr) {}
+
+    ~PacketThreadCache() {
+        flush();
+    }
+
+    void flush() {
+        if (!pool) {
+            return;
+        }
+        for (uint8_t i = 0; i < PacketPool::SIZE_CLASSES; i++) {
+            pool->give_back(i, free_lists[i], free_lists[i].size());
+        }
+        pool = nullptr;
+    }
+
+    // Bind to a pool; a thread only caches for one pool at a time
+    void use(PacketPool* owner) {
+        if (pool != owner) {
+            flush();
+            pool = owner;
+        }
+    }
+};
+
+static thread_local PacketThreadCache thread_cache;
+
+static size_t align_slot(size_t size) {
+    return (size + PACKET_CACHE_LINE - 1) / PACKET_CACHE_LINE * PACKET_CACHE_LINE;
+}
+
+void PacketRelease::operator()(PacketBuffer* buffer) const {
+    if (buffer) {
+        buffer->pool->release(buffer);
+    }
+}
+
+PacketPool::PacketPool() : numa_node(-1) {
+    size_t data_sizes[SIZE_CLASSES] = {PACKET_SMALL_SIZE, PACKET_LARGE_SIZE};
+    size_t preallocs[SIZE_CLASSES] = {PACKET_SMALL_PREALLOC, PACKET_LARGE_PREALLOC};
+    size_t limits[SIZE_CLASSES] = {PACKET_SMALL_MAX, PACKET_LARGE_MAX};
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    for (uint8_t i = 0; i < SIZE_CLASSES; i++) {
+        classes[i].data_size = data_sizes[i];
+        classes[i].slot_size = align_slot(PACKET_HEADROOM + data_sizes[i] + PACKET_TAILROOM);
+        classes[i].prealloc = preallocs[i];
+        classes[i].max_buffers = limits[i];
+        classes[i].allocated = 0;
+        if (!grow(i, preallocs[i])) {
+            Logger::log(LogLevel::WARNING, "Failed to preallocate packet buffers");
+        }
+    }
+}
+
+PacketPool::~PacketPool() {
+    // Buffers cached by this thread must not outlive the pool
+    if (thread_cache.pool == this) {
+        thread_cache.pool = nullptr;
+        for (auto& free_list : thread_cache.free_lists) {
+            free_list.clear();
+        }
+    }
+    for (Region& region : regions) {
+        free(region.memory);
+    }
+}
+
+bool PacketPool::grow(uint8_t size_class, size_t count) {
+    SizeClass& sc = classes[size_class];
+    count = std::min(count, sc.max_buffers - sc.allocated);
+    if (count == 0 || regions.size() >= UINT16_MAX) {
+        return false;
+    }
+
+    Region region;
+    region.size = (sc.slot_size * count + PACKET_REGION_ALIGN - 1) / PACKET_REGION_ALIGN * PACKET_REGION_ALIGN;
+    region.memory = static_cast<char*>(aligned_alloc(PACKET_REGION_ALIGN, region.size));
+    if (!region.memory) {
+        return false;
+    }
+    region.buffers.reset(new PacketBuffer[count]);
+    if (numa_node >= 0) {
+        bind_region(region);
+    }
+
+    // Fault the pages in now rather than on the data path
+    memset(region.memory, 0, region.size);
+
+    for (size_t i = 0; i < count; i++) {
+        PacketBuffer* buffer = &region.buffers[i];
+        buffer->head = region.memory + i * sc.slot_size;
+        buffer->capacity = sc.slot_size;
+        buffer->pool = this;
+        buffer->size_class = size_class;
+        buffer->region = static_cast<uint16_t>(regions.size());
+        sc.free_list.push_back(buffer);
+    }
+    sc.allocated += count;
+    regions.push_back(std::move(region));
+    return true;
+}
+
+void PacketPool::refill(uint8_t size_class, std::vector<PacketBuffer*>& out, size_t count) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    SizeClass& sc = classes[size_class];
+    if (sc.free_list.empty()) {
+        grow(size_class, sc.prealloc);
+    }
+
+    count = std::min(count, sc.free_list.size());
+    out.insert(out.end(), sc.free_list.end() - count, sc.free_list.end());
+    sc.free_list.resize(sc.free_list.size() - count);
+}
+
+void PacketPool::give_back(uint8_t size_class, std::vector<PacketBuffer*>& buffers, size_t count) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    std::vector<PacketBuffer*>& free_list = classes[size_class].free_list;
+    free_list.insert(free_list.end(), buffers.end() - count, buffers.end());
+    buffers.resize(buffers.size() - count);
+}
+
+PacketPtr PacketPool::acquire(size_t size, PacketDirection direction) {
+    uint8_t size_class;
+    if (size <= PACKET_SMALL_SIZE) {
+        size_class = 0;
+    } else if (size <= PACKET_LARGE_SIZE) {
+        size_class = 1;
+    } else {
+        return PacketPtr();
+    }
+
+    thread_cache.use(this);
+    std::vector<PacketBuffer*>& cached = thread_cache.free_lists[size_class];
+    if (cached.empty()) {
+        refill(size_class, cached, PACKET_THREAD_CACHE / 2);
+        if (cached.empty()) {
+            return PacketPtr();
+        }
+    }
+
+    PacketBuffer* buffer = cached.back();
+    cached.pop_back();
+
+    buffer->offset = PACKET_HEADROOM;
+    buffer->length = 0;
+    buffer->direction = direction;
+    buffer->source.sin_family = 0;
+    buffer->flow_hash = 0;
+    return PacketPtr(buffer);
+}
+
+void PacketPool::release(PacketBuffer* buffer) {
+    thread_cache.use(this);
+    std::vector<PacketBuffer*>& cached = thread_cache.free_lists[buffer->size_class];
+    cached.push_back(buffer);
+
+    // Buffers freed on another thread than they were taken on flow back in batches
+    if (cached.size() > PACKET_THREAD_CACHE) {
+        give_back(buffer->size_class, cached, PACKET_THREAD_CACHE / 2);
+    }
+}
+
+bool PacketPool::bind_region(const Region& region) {
+    // mbind(2) via syscall: libnuma is not a dependency
+    unsigned long nodemask = 1UL << numa_node;
+    if (syscall(SYS_mbind, region.memory, region.size, MPOL_PREFERRED, &nodemask,
+                sizeof(nodemask) * 8, MPOL_MF_MOVE) != 0) {
+        Logger::log(LogLevel::WARNING, "Failed to bind packet buffers to NUMA node " + std::to_string(numa_node) + 
+                   ": " + NetworkUtils::get_error_string(errno));
+        return false;
+    }
+    return true;
+}
+
+bool PacketPool::bind_to_node(int node) {
+    if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    numa_node = node;
+    bool bound = true;
+    for (const Region& region : regions) {
+        bound = bind_region(region) && bound;
+    }
+    return bound;
+}
+
+std::vector<struct iovec> PacketPool::get_regions() const {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    std::vector<struct iovec> iovs(regions.size());
+    for (size_t i = 0; i < regions.size(); i++) {
+        iovs[i].iov_base = regions[i].memory;
+        iovs[i].iov_len = regions[i].size;
+    }
+    return iovs;
+}
@@ -0,0 +1,130 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include "utils.h"
+#include <memory>
+#include <sys/uio.h>
+
+// Slot layout: [headroom | data | tailroom], every slot cache-line aligned
+#define PACKET_CACHE_LINE 64
+#define PACKET_REGION_ALIGN 4096             // Regions start on a page (NUMA binding, io_uring)
+#define PACKET_HEADROOM 64                   // Frame header or virtio_net_hdr, prepended in place
+#define PACKET_TAILROOM 64                   // Spare room after the data, appended in place
+#define PACKET_SMALL_SIZE BUFFER_SIZE        // MTU-sized packets and their frames
+#define PACKET_LARGE_SIZE (64 * 1024 + 256)  // GSO super-packets and their frames
+
+// Pool sizing per size class
+#define PACKET_SMALL_PREALLOC 2048           // Allocated up front (~8 MB)
+#define PACKET_LARGE_PREALLOC 64             // Allocated up front (~4 MB)
+#define PACKET_SMALL_MAX 16384               // Growth limit; acquire() fails beyond it
+#define PACKET_LARGE_MAX 1024
+#define PACKET_THREAD_CACHE 128              // Free buffers a thread keeps before returning half
+
+class PacketPool;
+
+enum class PacketDirection : uint8_t {
+    TUN_TO_SOCKET,
+    SOCKET_TO_TUN
+};
+
+// One pooled packet. push()/pull() move the start of the data into or out of
+// the headroom, so headers are added and stripped without copying.
+struct PacketBuffer {
+    char* head;                 // Slot start
+    size_t capacity;            // Slot bytes, headroom and tailroom included
+    size_t offset;              // Data start
+    size_t length;              // Data bytes
+    PacketDirection direction;
+    struct sockaddr_in source;  // Sender of a UDP datagram (sin_family 0 otherwise)
+    uint32_t flow_hash;         // 5-tuple hash for flow steering (0 if not computed)
+    PacketPool* pool;
+    uint8_t size_class;
+    uint16_t region;            // Memory region holding the slot (io_uring fixed buffer index)
+
+    char* data() { return head + offset; }
+    const char* data() const { return head + offset; }
+    size_t size() const { return length; }
+    size_t headroom() const { return offset; }
+    size_t tailroom() const { return capacity - offset - length; }
+
+    // Grow the data at the front (caller checks headroom()), or drop bytes from it
+    char* push(size_t bytes) { offset -= bytes; length += bytes; return data(); }
+    void pull(size_t bytes) { offset += bytes; length -= bytes; }
+
+    // Set the data length after writing into data() (reads, in-place crypto)
+    void set_size(size_t bytes) { length = bytes; }
+};
+
+// Returns a buffer to its pool
+struct PacketRelease {
+    void operator()(PacketBuffer* buffer) const;
+};
+typedef std::unique_ptr<PacketBuffer, PacketRelease> PacketPtr;
+
+// Fixed-size, preallocated packet buffers in two size classes. Each thread
+// keeps a small free list of its own, so acquire/release normally take no
+// lock; the shared free list is touched in batches of half a thread cache.
+class PacketPool {
+public:
+    static const size_t SIZE_CLASSES = 2;
+
+private:
+    struct Region {
+        char* memory;
+        size_t size;
+        std::unique_ptr<PacketBuffer[]> buffers;
+    };
+
+    struct SizeClass {
+        size_t data_size;
+        size_t slot_size;
+        size_t prealloc;
+        size_t max_buffers;
+        size_t allocated;
+        std::vector<PacketBuffer*> free_list;
+    };
+
+    SizeClass classes[SIZE_CLASSES];
+    std::vector<Region> regions;
+    int numa_node;  // Node regions are bound to, -1 for the default policy
+    mutable std::mutex pool_mutex;
+    
+    // Prefer numa_node for a region's pages, moving those already touched
+    bool bind_region(const Region& region);
+
+    // Add a region of count slots to a class, caller holds pool_mutex
+    bool grow(uint8_t size_class, size_t count);
+
+    // Move up to count free buffers of a class into out
+    void refill(uint8_t size_class, std::vector<PacketBuffer*>& out, size_t count);
+
+    // Take back buffers a thread cache gives up
+    void give_back(uint8_t size_class, std::vector<PacketBuffer*>& buffers, size_t count);
+
+    friend struct PacketThreadCache;
+
+public:
+    PacketPool();
+    ~PacketPool();
+
+    // Disable copy constructor and assignment operator
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    // Buffer with room for size data bytes after the headroom; empty when the
+    // pool is exhausted or size exceeds PACKET_LARGE_SIZE
+    PacketPtr acquire(size_t size, PacketDirection direction = PacketDirection::TUN_TO_SOCKET);
+
+    void release(PacketBuffer* buffer);
+
+    // Keep all buffers, present and future, on one NUMA node
+    bool bind_to_node(int node);
+
+    // Memory regions allocated so far (for io_uring buffer registration)
+    std::vector<struct iovec> get_regions() const;
+
+    // Largest data size a buffer can take
+    static size_t max_size() { return PACKET_LARGE_SIZE; }
+};
+
+#endif // PACKET_POOL_H
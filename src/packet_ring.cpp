@@ -0,0 +1,45 @@
+#include "packet_ring.h"
+#include <sys/eventfd.h>
+#include <poll.h>
+
+RingWaiter::RingWaiter() : event_fd(-1), spin_count(RING_SPIN_COUNT), spin_usec(0), parked(false) {
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0) {
+        Logger::log(LogLevel::ERROR, "Failed to create ring eventfd: " + NetworkUtils::get_error_string(errno));
+    }
+
+    // Spinning only helps when the producer runs on another CPU
+    if (std::thread::hardware_concurrency() <= 1) {
+        spin_count = 0;
+    }
+}
+
+RingWaiter::~RingWaiter() {
+    if (event_fd >= 0) {
+        close(event_fd);
+    }
+}
+
+void RingWaiter::sleep(long timeout_usec) {
+    struct pollfd pfd;
+    pfd.fd = event_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    struct timespec timeout;
+    if (timeout_usec >= 0) {
+        timeout.tv_sec = timeout_usec / 1000000;
+        timeout.tv_nsec = (timeout_usec % 1000000) * 1000;
+    }
+    if (ppoll(&pfd, 1, timeout_usec >= 0 ? &timeout : nullptr, nullptr) > 0) {
+        uint64_t count;
+        ssize_t ignored = read(event_fd, &count, sizeof(count));
+        (void)ignored;
+    }
+}
+
+void RingWaiter::wakeup() {
+    uint64_t one = 1;
+    ssize_t ignored = write(event_fd, &one, sizeof(one));
+    (void)ignored;
+}
@@ -0,0 +1,159 @@
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include "utils.h"
+#include <atomic>
+#include <algorithm>
+
+// Ring and wakeup settings
+#define RING_CAPACITY 4096       // Slots per ring (power of two); a full ring drops
+#define RING_SPIN_COUNT 2000     // Empty polls before a consumer parks (0 on one CPU)
+#define RING_CACHE_LINE 64
+#define RING_CLOCK_CHECK 64      // Spin iterations between clock reads in a timed spin
+
+// Spin-wait hint for the CPU
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Bounded lock-free single-producer/single-consumer ring. Producer and
+// consumer indices live on separate cache lines; each side keeps a cached
+// copy of the other's index so the shared line is only read when the ring
+// looks full (producer) or empty (consumer).
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    alignas(RING_CACHE_LINE) std::atomic<size_t> head;  // Next slot to read (consumer)
+    size_t cached_tail;
+
+    alignas(RING_CACHE_LINE) std::atomic<size_t> tail;  // Next slot to write (producer)
+    size_t cached_head;
+
+public:
+    explicit SpscRing(size_t capacity = RING_CAPACITY)
+        : slots(capacity), mask(capacity - 1), head(0), cached_tail(0), tail(0), cached_head(0) {}
+
+    // Disable copy constructor and assignment operator
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: false when full (item is left untouched)
+    bool push(T&& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head > mask) {
+                return false;
+            }
+        }
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: append up to max items to out; returns how many
+    size_t pop_batch(std::vector<T>& out, size_t max) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        size_t count = std::min(cached_tail - h, max);
+        for (size_t i = 0; i < count; i++) {
+            out.push_back(std::move(slots[(h + i) & mask]));
+        }
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    // Either side; exact only for the consumer
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+// Adaptive blocking for a ring consumer: spin first, then sleep on an
+// eventfd. Producers only pay for the eventfd write while the consumer is
+// actually parked.
+class RingWaiter {
+private:
+    int event_fd;
+    unsigned spin_count;
+    std::atomic<long> spin_usec;  // Latency mode: keep spinning this long before parking
+    std::atomic<bool> parked;
+
+    // Sleep on the eventfd; timeout_usec < 0 waits indefinitely
+    void sleep(long timeout_usec);
+
+public:
+    RingWaiter();
+    ~RingWaiter();
+
+    // Disable copy constructor and assignment operator
+    RingWaiter(const RingWaiter&) = delete;
+    RingWaiter& operator=(const RingWaiter&) = delete;
+
+    bool is_valid() const { return event_fd >= 0; }
+
+    // Latency mode: spin for up to usec before parking (0: spin_count polls only).
+    // Takes effect on the next wait(), from any thread.
+    void set_spin_usec(long usec) { spin_usec.store(usec, std::memory_order_relaxed); }
+
+    // Consumer: wait until ready() holds or the timeout passes; returns ready()
+    template <typename Ready>
+    bool wait(Ready ready, long timeout_usec = -1) {
+        for (unsigned i = 0; i < spin_count; i++) {
+            if (ready()) {
+                return true;
+            }
+            cpu_relax();
+        }
+
+        // Timed spin, bounded by the caller's timeout
+        long spin = spin_usec.load(std::memory_order_relaxed);
+        if (timeout_usec >= 0) {
+            spin = std::min(spin, timeout_usec);
+        }
+        if (spin > 0) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spin);
+            for (unsigned i = 1; ; i++) {
+                if (ready()) {
+                    return true;
+                }
+                cpu_relax();
+                if (i % RING_CLOCK_CHECK == 0 && std::chrono::steady_clock::now() >= deadline) {
+                    break;
+                }
+            }
+        }
+
+        // Announce the park before the last check, so a producer that pushes
+        // after it sees the flag (pairs with the fence in notify())
+        parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready() && timeout_usec != 0) {
+            sleep(timeout_usec);
+        }
+        parked.store(false, std::memory_order_relaxed);
+        return ready();
+    }
+
+    // Producer: wake the consumer if it is parked (call after pushing)
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed)) {
+            wakeup();
+        }
+    }
+
+    // Unconditional wakeup (shutdown)
+    void wakeup();
+};
+
+#endif // PACKET_RING_H
@@ -1,10 +1,71 @@
 #include "socket_manager.h"
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+#include <algorithm>
+#include <climits>
+
+// Busy-poll options missing from older headers
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+#define BUSY_POLL_BUDGET 64  // Packets per busy-poll pass
+
+// Room for one UDP_GRO control message
+#define UDP_GRO_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+
+DatagramBatch::DatagramBatch(size_t count, size_t slot_size)
+    : slot_size(slot_size), buffers(count * slot_size), msgs(count), iovs(count), sources(count),
+      controls(count * UDP_GRO_CONTROL_SIZE) {
+    memset(msgs.data(), 0, count * sizeof(struct mmsghdr));
+    for (size_t i = 0; i < count; i++) {
+        iovs[i].iov_base = buffers.data() + i * slot_size;
+        iovs[i].iov_len = slot_size;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &sources[i];
+        msgs[i].msg_hdr.msg_control = controls.data() + i * UDP_GRO_CONTROL_SIZE;
+    }
+    reset();
+}
+
+void DatagramBatch::reset() {
+    for (auto& msg : msgs) {
+        msg.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msg.msg_hdr.msg_controllen = UDP_GRO_CONTROL_SIZE;
+    }
+}
+
+size_t DatagramBatch::segment_size(size_t index) const {
+    const struct msghdr* hdr = &msgs[index].msg_hdr;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg; 
+         cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(hdr), cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int gso_size;
+            memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+            if (gso_size > 0) {
+                return gso_size;
+            }
+        }
+    }
+    return size(index);
+}
+
+// Address and port in one word, never 0
+static uint64_t pack_peer(const struct sockaddr_in& addr) {
+    return 1ULL << 48 | static_cast<uint64_t>(addr.sin_addr.s_addr) << 16 | addr.sin_port;
+}
 
 SocketManager::SocketManager() 
-    : socket_fd(-1), server_fd(-1), is_server(false), is_connected(false), port(0) {
+    : transport(Transport::TCP), socket_fd(-1), server_fd(-1), is_server(false), is_connected(false), 
+      port(0), has_peer(false), peer_key(0), udp_gso(false), udp_gro(false), busy_poll_usec(0), zerocopy(false), zerocopy_next(0),
+      zerocopy_done(0), zerocopy_copied(0) {
     memset(&server_addr, 0, sizeof(server_addr));
     memset(&client_addr, 0, sizeof(client_addr));
+    memset(&peer_addr, 0, sizeof(peer_addr));
 }
 
 SocketManager::~SocketManager() {
@@ -16,7 +77,7 @@ bool SocketManager::start_server(int port) {
     this->is_server = true;
     
     // Create socket
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    server_fd = socket(AF_INET, is_datagram() ? SOCK_DGRAM : SOCK_STREAM, 0);
     if (server_fd < 0) {
         Logger::log(LogLevel::ERROR, "Failed to create server socket: " + 
                    NetworkUtils::get_error_string(errno));
@@ -43,6 +104,15 @@ bool SocketManager::start_server(int port) {
         return false;
     }
     
+    // A datagram socket serves the peer directly; it is known once it authenticates
+    if (is_datagram()) {
+        socket_fd = server_fd;
+        server_fd = -1;
+        is_connected = true;
+        Logger::log(LogLevel::INFO, "Server bound to UDP port " + std::to_string(port));
+        return true;
+    }
+    
     // Start listening
     if (listen(server_fd, 1) < 0) {
         Logger::log(LogLevel::ERROR, "Failed to listen on server socket: " + 
@@ -57,6 +127,10 @@ bool SocketManager::start_server(int port) {
 }
 
 bool SocketManager::accept_connection() {
+    if (is_datagram()) {
+        return is_server && socket_fd >= 0;
+    }
+    
     if (!is_server || server_fd < 0) {
         Logger::log(LogLevel::ERROR, "Server not started");
         return false;
@@ -90,7 +164,7 @@ bool SocketManager::connect_to_server(const std::string& server_ip, int port) {
     this->is_server = false;
     
     // Create socket
-    socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    socket_fd = socket(AF_INET, is_datagram() ? SOCK_DGRAM : SOCK_STREAM, 0);
     if (socket_fd < 0) {
         Logger::log(LogLevel::ERROR, "Failed to create client socket: " + 
                    NetworkUtils::get_error_string(errno));
@@ -115,6 +189,16 @@ bool SocketManager::connect_to_server(const std::string& server_ip, int port) {
         return false;
     }
     
+    // Datagrams go to the server address; nothing to connect
+    if (is_datagram()) {
+        peer_addr = server_addr;
+        has_peer = true;
+        peer_key = pack_peer(server_addr);
+        is_connected = true;
+        Logger::log(LogLevel::INFO, "Sending UDP to server " + get_remote_endpoint());
+        return true;
+    }
+    
     // Connect to server
     if (connect(socket_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         Logger::log(LogLevel::ERROR, "Failed to connect to server: " + 
@@ -136,25 +220,318 @@ ssize_t SocketManager::send_data(const char* buffer, size_t data_size) {
         return -1;
     }
     
-    ssize_t bytes_sent = send(socket_fd, buffer, data_size, MSG_NOSIGNAL);
-    if (bytes_sent < 0) {
-        if (errno != EAGAIN && errno != EWOULDBLOCK) {
-            Logger::log(LogLevel::ERROR, "Failed to send data: " + 
-                       NetworkUtils::get_error_string(errno));
-            is_connected = false;
-        }
+    // Frames must go out whole and must not interleave on the stream
+    std::lock_guard<std::mutex> lock(send_mutex);
+    
+    if (is_datagram()) {
+        struct iovec frame = {const_cast<char*>(buffer), data_size};
+        return send_datagrams(&frame, 1) == 1 ? static_cast<ssize_t>(data_size) : -1;
+    }
+    
+    if (!send_all(buffer, data_size)) {
+        return -1;
+    }
+    
+    return data_size;
+}
+
+ssize_t SocketManager::send_data_to(const char* buffer, size_t data_size, const struct sockaddr_in& addr) {
+    if (!is_datagram() || addr.sin_family != AF_INET) {
+        return send_data(buffer, data_size);
+    }
+    if (!is_connected || socket_fd < 0) {
         return -1;
     }
     
-    return bytes_sent;
+    std::lock_guard<std::mutex> lock(send_mutex);
+    return sendto(socket_fd, buffer, data_size, MSG_NOSIGNAL,
+                  reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr));
+}
+
+ssize_t SocketManager::send_frames(const struct iovec* frames, size_t count) {
+    if (!is_connected || socket_fd < 0) {
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(send_mutex);
+    
+    if (is_datagram()) {
+        return send_datagrams(frames, count);
+    }
+    
+    size_t sent = 0;
+    if (!send_iov(frames, count, sent)) {
+        return -1;
+    }
+    
+    return static_cast<ssize_t>(count);
+}
+
+ssize_t SocketManager::send_frames_zerocopy(const struct iovec* frames, size_t count, uint32_t& zerocopy_id,
+                                            bool& pinned) {
+    pinned = false;
+    if (!is_connected || socket_fd < 0) {
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(send_mutex);
+    
+    // The batch is done once the last id the kernel assigned to it completes;
+    // a batch that got none (copied, or nothing sent) is not referenced at all
+    uint32_t first_id = zerocopy_next;
+    bool sent = send_iov(frames, count, 0, zerocopy ? MSG_ZEROCOPY : 0);
+    pinned = zerocopy_next != first_id;
+    zerocopy_id = zerocopy_next - 1;
+    return sent ? static_cast<ssize_t>(count) : -1;
+}
+
+bool SocketManager::zerocopy_complete(uint32_t zerocopy_id) {
+    std::lock_guard<std::mutex> lock(send_mutex);
+    
+    // Ids wrap around; compare by distance
+    if (static_cast<int32_t>(zerocopy_id - zerocopy_done) < 0) {
+        return true;
+    }
+    reap_zerocopy();
+    return static_cast<int32_t>(zerocopy_id - zerocopy_done) < 0;
+}
+
+void SocketManager::reap_zerocopy() {
+    if (socket_fd < 0) {
+        return;
+    }
+    
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 4];
+    while (true) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        
+        if (recvmsg(socket_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            return;  // EAGAIN: nothing more completed
+        }
+        
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+                continue;
+            }
+            
+            // [ee_info, ee_data] completed; merge into the done watermark
+            zerocopy_early[err.ee_info] = err.ee_data;
+            auto range = zerocopy_early.find(zerocopy_done);
+            while (range != zerocopy_early.end()) {
+                zerocopy_done = range->second + 1;
+                zerocopy_early.erase(range);
+                range = zerocopy_early.find(zerocopy_done);
+            }
+            
+            // Pinning pages only pays off if the data really leaves without a copy
+            // (it does not for local or loopback peers)
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                if (zerocopy && ++zerocopy_copied >= ZEROCOPY_COPIED_LIMIT) {
+                    Logger::log(LogLevel::INFO, "Kernel keeps copying zero-copy sends, disabling MSG_ZEROCOPY");
+                    zerocopy = false;
+                }
+            } else {
+                zerocopy_copied = 0;
+            }
+        }
+    }
+}
+
+bool SocketManager::enable_zerocopy() {
+    if (socket_fd < 0 || is_datagram()) {
+        return false;
+    }
+    
+    int enable = 1;
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) < 0) {
+        Logger::log(LogLevel::INFO, "MSG_ZEROCOPY not supported: " + NetworkUtils::get_error_string(errno));
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(send_mutex);
+    zerocopy = true;
+    zerocopy_copied = 0;
+    Logger::log(LogLevel::INFO, "Zero-copy transmit enabled");
+    return true;
+}
+
+bool SocketManager::send_iov(const struct iovec* frames, size_t count, size_t skip, int flags) {
+    // Local copy: partial sends advance the vector in place
+    std::vector<struct iovec> iov(frames, frames + count);
+    size_t index = 0;
+    
+    while (index < count) {
+        // Drop whatever has already gone out
+        while (index < count && skip >= iov[index].iov_len) {
+            skip -= iov[index].iov_len;
+            index++;
+        }
+        if (index == count) {
+            break;
+        }
+        iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + skip;
+        iov[index].iov_len -= skip;
+        
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov[index];
+        msg.msg_iovlen = std::min<size_t>(count - index, IOV_MAX);
+        
+        ssize_t bytes_sent = sendmsg(socket_fd, &msg, MSG_NOSIGNAL | flags);
+        if (bytes_sent < 0) {
+            if (errno == EINTR) {
+                skip = 0;
+                continue;
+            }
+            // Out of optmem for pinned pages: copy this part instead
+            if ((flags & MSG_ZEROCOPY) && errno == ENOBUFS) {
+                flags &= ~MSG_ZEROCOPY;
+                skip = 0;
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                Logger::log(LogLevel::ERROR, "Failed to send data: " + 
+                           NetworkUtils::get_error_string(errno));
+                is_connected = false;
+            }
+            return false;
+        }
+        if ((flags & MSG_ZEROCOPY) && bytes_sent > 0) {
+            zerocopy_next++;
+        }
+        skip = bytes_sent;
+    }
+    
+    return true;
+}
+
+ssize_t SocketManager::send_datagrams(const struct iovec* frames, size_t count) {
+    if (!has_peer) {
+        return -1;  // Server that has not heard from an authenticated client yet
+    }
+    
+    struct mmsghdr msgs[UDP_BATCH_SIZE];
+    size_t frame_counts[UDP_BATCH_SIZE];
+    alignas(struct cmsghdr) char controls[UDP_BATCH_SIZE][CMSG_SPACE(sizeof(uint16_t))];
+    size_t sent = 0;
+    
+    while (sent < count) {
+        // One message per frame, or per run of equal-sized frames with UDP_SEGMENT
+        // (the last frame of a run may be shorter)
+        unsigned batch = 0;
+        size_t next = sent;
+        memset(msgs, 0, sizeof(msgs));
+        while (next < count && batch < UDP_BATCH_SIZE) {
+            size_t run = 1;
+            size_t segment_size = frames[next].iov_len;
+            size_t run_bytes = segment_size;
+            if (udp_gso) {
+                while (next + run < count && run < UDP_GSO_MAX_SEGMENTS &&
+                       frames[next + run].iov_len <= segment_size &&
+                       run_bytes + frames[next + run].iov_len <= UDP_GSO_MAX_BYTES) {
+                    run_bytes += frames[next + run].iov_len;
+                    run++;
+                    if (frames[next + run - 1].iov_len < segment_size) {
+                        break;
+                    }
+                }
+            }
+            
+            struct msghdr* hdr = &msgs[batch].msg_hdr;
+            hdr->msg_name = &peer_addr;
+            hdr->msg_namelen = sizeof(peer_addr);
+            hdr->msg_iov = const_cast<struct iovec*>(&frames[next]);
+            hdr->msg_iovlen = run;
+            if (run > 1) {
+                hdr->msg_control = controls[batch];
+                hdr->msg_controllen = sizeof(controls[batch]);
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gso_size = static_cast<uint16_t>(segment_size);
+                memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+            }
+            frame_counts[batch++] = run;
+            next += run;
+        }
+        
+        int result = sendmmsg(socket_fd, msgs, batch, 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Devices without checksum offload reject GSO sends; segment in userspace from now on
+            if (udp_gso && (errno == EIO || errno == EINVAL)) {
+                Logger::log(LogLevel::WARNING, "UDP segmentation offload rejected, disabling: " + 
+                           NetworkUtils::get_error_string(errno));
+                udp_gso = false;
+                continue;
+            }
+            // Datagrams may be lost anyway; report what made it out
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+                Logger::log(LogLevel::ERROR, "Failed to send datagrams: " + 
+                           NetworkUtils::get_error_string(errno));
+            }
+            break;
+        }
+        for (int i = 0; i < result; i++) {
+            sent += frame_counts[i];
+        }
+    }
+    
+    return sent > 0 ? static_cast<ssize_t>(sent) : -1;
+}
+
+void SocketManager::probe_udp_offload(int fd) {
+    // Setting a zero segment size only checks that UDP_SEGMENT exists;
+    // the size itself travels with each send
+    int zero = 0;
+    udp_gso = setsockopt(fd, SOL_UDP, UDP_SEGMENT, &zero, sizeof(zero)) == 0;
+    
+    int enable = 1;
+    udp_gro = setsockopt(fd, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+    
+    Logger::log(LogLevel::INFO, std::string("UDP offload: segmentation ") + (udp_gso ? "on" : "off") + 
+               ", receive coalescing " + (udp_gro ? "on" : "off"));
+}
+
+bool SocketManager::send_all(const char* buffer, size_t data_size) {
+    size_t total_sent = 0;
+    while (total_sent < data_size) {
+        ssize_t bytes_sent = send(socket_fd, buffer + total_sent, data_size - total_sent, MSG_NOSIGNAL);
+        if (bytes_sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                Logger::log(LogLevel::ERROR, "Failed to send data: " + 
+                           NetworkUtils::get_error_string(errno));
+                is_connected = false;
+            }
+            return false;
+        }
+        total_sent += bytes_sent;
+    }
+    
+    return true;
 }
 
-ssize_t SocketManager::receive_data(char* buffer, size_t buffer_size) {
+ssize_t SocketManager::receive_data(char* buffer, size_t buffer_size, bool dont_wait) {
     if (!is_connected || socket_fd < 0) {
         return -1;
     }
     
-    ssize_t bytes_received = recv(socket_fd, buffer, buffer_size, 0);
+    ssize_t bytes_received = recv(socket_fd, buffer, buffer_size, dont_wait ? MSG_DONTWAIT : 0);
     if (bytes_received < 0) {
         if (errno != EAGAIN && errno != EWOULDBLOCK) {
             Logger::log(LogLevel::ERROR, "Failed to receive data: " + 
@@ -172,6 +549,42 @@ ssize_t SocketManager::receive_data(char* buffer, size_t buffer_size) {
     return bytes_received;
 }
 
+int SocketManager::receive_datagrams(DatagramBatch& batch) {
+    if (!is_connected || socket_fd < 0) {
+        return -1;
+    }
+    
+    batch.reset();
+    int received = recvmmsg(socket_fd, batch.msgs.data(), batch.capacity(), MSG_DONTWAIT, nullptr);
+    if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        Logger::log(LogLevel::ERROR, "Failed to receive datagrams: " + 
+                   NetworkUtils::get_error_string(errno));
+    }
+    return received;
+}
+
+void SocketManager::update_peer(const struct sockaddr_in& addr) {
+    // Called for every authenticated datagram; the peer rarely moves
+    uint64_t key = pack_peer(addr);
+    if (peer_key.load(std::memory_order_relaxed) == key) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(send_mutex);
+    if (peer_key.load(std::memory_order_relaxed) == key) {
+        return;
+    }
+    
+    peer_addr = addr;
+    has_peer = true;
+    peer_key.store(key, std::memory_order_relaxed);
+    if (is_server) {
+        client_addr = addr;
+    }
+    Logger::log(LogLevel::INFO, "Peer address is now " + std::string(inet_ntoa(addr.sin_addr)) + ":" + 
+               std::to_string(ntohs(addr.sin_port)));
+}
+
 void SocketManager::close_connection() {
     if (socket_fd >= 0) {
         close(socket_fd);
@@ -184,6 +597,8 @@ void SocketManager::close_connection() {
     }
     
     is_connected = false;
+    has_peer = false;
+    peer_key = 0;
     
     if (is_server) {
         Logger::log(LogLevel::INFO, "Server socket closed");
@@ -218,7 +633,7 @@ bool SocketManager::configure_keepalive() {
 }
 
 std::string SocketManager::get_remote_endpoint() const {
-    if (is_server && is_connected) {
+    if (is_server && is_connected && client_addr.sin_family == AF_INET) {
         return std::string(inet_ntoa(client_addr.sin_addr)) + ":" + 
                std::to_string(ntohs(client_addr.sin_port));
     } else if (!is_server) {
@@ -244,10 +659,44 @@ bool SocketManager::configure_socket_options(int fd) {
         Logger::log(LogLevel::WARNING, "Failed to set SO_REUSEADDR");
     }
     
+    if (is_datagram()) {
+        int buffer_size = UDP_SOCKET_BUFFER;
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size)) < 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size)) < 0) {
+            Logger::log(LogLevel::WARNING, "Failed to size UDP socket buffers");
+        }
+        probe_udp_offload(fd);
+        apply_busy_poll(fd);
+        return true;
+    }
+    
     // Disable Nagle's algorithm for lower latency
     if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) < 0) {
         Logger::log(LogLevel::WARNING, "Failed to set TCP_NODELAY");
     }
     
+    apply_busy_poll(fd);
     return true;
 }
+
+void SocketManager::apply_busy_poll(int fd) {
+    if (busy_poll_usec <= 0) {
+        return;
+    }
+    
+    // SO_BUSY_POLL above the sysctl default needs CAP_NET_ADMIN
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_usec, sizeof(busy_poll_usec)) < 0) {
+        Logger::log(LogLevel::INFO, "SO_BUSY_POLL not available: " + NetworkUtils::get_error_string(errno));
+        return;
+    }
+    
+    // Preferring busy polling keeps softirq processing off the device queue
+    // while this socket polls it; both are hints newer kernels understand
+    int enable = 1;
+    int budget = BUSY_POLL_BUDGET;
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &enable, sizeof(enable)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &budget, sizeof(budget)) < 0) {
+        Logger::log(LogLevel::DEBUG, "SO_PREFER_BUSY_POLL not available: " + NetworkUtils::get_error_string(errno));
+    }
+    Logger::log(LogLevel::DEBUG, "Socket busy poll set to " + std::to_string(busy_poll_usec) + " us");
+}
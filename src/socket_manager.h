@@ -2,18 +2,81 @@
 #define SOCKET_MANAGER_H
 
 #include "utils.h"
+#include <map>
+
+// Datagram transport settings
+#define UDP_BATCH_SIZE 64                    // Datagrams per recvmmsg/sendmmsg
+#define UDP_MAX_DATAGRAM BUFFER_SIZE         // Receive slot size; larger datagrams are dropped
+#define UDP_SOCKET_BUFFER (4 * 1024 * 1024)  // SO_RCVBUF/SO_SNDBUF, absorbs bursts
+#define UDP_TUN_MTU MTU_SIZE                 // 1408 + header (36) + IP/UDP (28) fits in 1500; AEAD adds no padding
+
+// UDP segmentation offload (UDP_SEGMENT / UDP_GRO)
+#define UDP_GSO_MAX_SEGMENTS 64              // Kernel limit per GSO send
+#define UDP_GSO_MAX_BYTES 65000              // Stays below the 65507-byte UDP payload limit
+#define UDP_GRO_BATCH_SIZE 16                // Coalesced datagrams per recvmmsg
+#define UDP_GRO_MAX_DATAGRAM 65536           // Receive slot for a coalesced datagram
+
+// Zero-copy transmit (SO_ZEROCOPY / MSG_ZEROCOPY, TCP only)
+#define ZEROCOPY_THRESHOLD (32 * 1024)       // Smallest send worth pinning pages for
+#define ZEROCOPY_COPIED_LIMIT 64             // Completions the kernel had to copy before giving up
+
+enum class Transport {
+    TCP,  // Frames on a byte stream
+    UDP   // One frame per datagram
+};
+
+// Receive slots for one recvmmsg call. With UDP_GRO a slot may hold several
+// equal-sized datagrams back to back (segment_size() tells their size).
+struct DatagramBatch {
+    size_t slot_size;
+    std::vector<char> buffers;
+    std::vector<struct mmsghdr> msgs;
+    std::vector<struct iovec> iovs;
+    std::vector<struct sockaddr_in> sources;
+    std::vector<char> controls;
+
+    explicit DatagramBatch(size_t count = UDP_BATCH_SIZE, size_t slot_size = UDP_MAX_DATAGRAM);
+
+    size_t capacity() const { return msgs.size(); }
+    const char* data(size_t index) const { return buffers.data() + index * slot_size; }
+    size_t size(size_t index) const { return msgs[index].msg_len; }
+    bool truncated(size_t index) const { return msgs[index].msg_hdr.msg_flags & MSG_TRUNC; }
+    const struct sockaddr_in& source(size_t index) const { return sources[index]; }
+
+    // Size of the datagrams coalesced in a slot (the whole slot without GRO)
+    size_t segment_size(size_t index) const;
+
+    // Restore the lengths recvmmsg overwrote
+    void reset();
+};
 
 class SocketManager {
 private:
+    Transport transport;
     int socket_fd;
     int server_fd;  // For server mode
     bool is_server;
     bool is_connected;
     std::string remote_ip;
     int port;
+    struct sockaddr_in peer_addr;     // UDP: where frames go, guarded by send_mutex
+    bool has_peer;
+    std::atomic<uint64_t> peer_key;   // peer_addr packed for lock-free compares (0 = no peer)
+    bool udp_gso;                     // UDP_SEGMENT usable (probed, cleared on send failure)
+    bool udp_gro;                     // UDP_GRO enabled on the socket
+    int busy_poll_usec;               // SO_BUSY_POLL for new sockets (0 = off)
+    
+    // Zero-copy state, guarded by send_mutex. Every MSG_ZEROCOPY sendmsg that
+    // queues data gets the next id; the error queue reports completed id ranges.
+    bool zerocopy;
+    uint32_t zerocopy_next;                       // Id of the next zero-copy send
+    uint32_t zerocopy_done;                       // Every id before this one has completed
+    std::map<uint32_t, uint32_t> zerocopy_early;  // Ranges completed out of order (lo -> hi)
+    unsigned zerocopy_copied;                     // Consecutive completions that fell back to copying
     struct sockaddr_in server_addr;
     struct sockaddr_in client_addr;
     mutable std::mutex socket_mutex;  // Thread safety
+    std::mutex send_mutex;            // Keeps frames whole on the stream
     std::chrono::steady_clock::time_point last_activity;
     int reconnect_attempts;
     static const int MAX_RECONNECT_ATTEMPTS = 5;
@@ -26,10 +89,20 @@ public:
     SocketManager(const SocketManager&) = delete;
     SocketManager& operator=(const SocketManager&) = delete;
     
-    // Server mode: start listening
+    // Select TCP or UDP; call before start_server/connect_to_server
+    void set_transport(Transport transport) { this->transport = transport; }
+    Transport get_transport() const { return transport; }
+    bool is_datagram() const { return transport == Transport::UDP; }
+    
+    // Latency mode: busy-poll the device queue for up to usec on socket reads
+    // (SO_BUSY_POLL/SO_PREFER_BUSY_POLL); call before start_server/connect_to_server
+    void set_busy_poll(int usec) { busy_poll_usec = usec; }
+    
+    // Server mode: start listening (UDP: bind)
     bool start_server(int port);
     
-    // Server mode: accept client connection
+    // Server mode: accept client connection (UDP: no-op, the peer is learned
+    // from its first authenticated packet)
     bool accept_connection();
     
     // Client mode: connect to server (with retry logic)
@@ -41,8 +114,39 @@ public:
     // Send data through socket (thread-safe)
     ssize_t send_data(const char* buffer, size_t data_size);
     
-    // Receive data from socket (thread-safe)  
-    ssize_t receive_data(char* buffer, size_t buffer_size);
+    // UDP: send one datagram to addr without making it the peer (thread-safe);
+    // a stream has only its peer, so this is send_data there
+    ssize_t send_data_to(const char* buffer, size_t data_size, const struct sockaddr_in& addr);
+    
+    // Send a batch of frames in order as one sendmsg (thread-safe)
+    ssize_t send_frames(const struct iovec* frames, size_t count);
+    
+    // Send a batch with MSG_ZEROCOPY (thread-safe). If pinned comes back true
+    // (even when the send failed part way), the frame buffers must stay
+    // untouched until zerocopy_complete(zerocopy_id) returns true; otherwise
+    // nothing references them. Returns the number of frames sent or -1; falls
+    // back to copying if zero-copy is off.
+    ssize_t send_frames_zerocopy(const struct iovec* frames, size_t count, uint32_t& zerocopy_id, bool& pinned);
+    
+    // Reap the error queue; true once the send with this id has completed
+    bool zerocopy_complete(uint32_t zerocopy_id);
+    
+    // TCP: set SO_ZEROCOPY; false if the kernel does not support it
+    bool enable_zerocopy();
+    bool is_zerocopy_enabled() const { return zerocopy; }
+    
+    // Receive data from socket (thread-safe); dont_wait returns -1/EAGAIN when drained
+    ssize_t receive_data(char* buffer, size_t buffer_size, bool dont_wait = false);
+    
+    // UDP: receive up to batch.capacity() datagrams without blocking;
+    // returns the number received, or -1 (EAGAIN when drained)
+    int receive_datagrams(DatagramBatch& batch);
+    
+    // UDP: send subsequent frames to this address (roaming peer)
+    void update_peer(const struct sockaddr_in& addr);
+    
+    // UDP: whether received datagrams may arrive coalesced (size batches for it)
+    bool has_udp_gro() const { return udp_gro; }
     
     // Check connection health
     bool check_connection_health();
@@ -79,6 +183,24 @@ public:
     }
     
 private:
+    // Write the whole buffer, caller holds send_mutex
+    bool send_all(const char* buffer, size_t data_size);
+    
+    // Write the frames after the first skip bytes with sendmsg, caller holds send_mutex.
+    // With MSG_ZEROCOPY in flags, each call that queues data takes a zero-copy id.
+    bool send_iov(const struct iovec* frames, size_t count, size_t skip, int flags = 0);
+    
+    // Drain zero-copy completions from the error queue, caller holds send_mutex
+    void reap_zerocopy();
+    
+    // Send each frame as one datagram to the peer with sendmmsg, caller holds send_mutex.
+    // With UDP_SEGMENT, runs of equal-sized frames go out as one GSO message each.
+    ssize_t send_datagrams(const struct iovec* frames, size_t count);
+    
+    // Enable UDP_SEGMENT / UDP_GRO where the kernel supports them
+    void probe_udp_offload(int fd);
+    void apply_busy_poll(int fd);
+    
     // Set socket to non-blocking mode
     bool set_non_blocking(int fd);
     
@@ -0,0 +1,128 @@
+#include "thread_placement.h"
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sstream>
+
+static const char* ROLE_NAMES[] = {"tun", "socket", "encrypt", "decrypt", "crypto", "heartbeat"};
+
+const char* ThreadPlacement::role_name(ThreadRole role) {
+    return ROLE_NAMES[static_cast<size_t>(role)];
+}
+
+bool ThreadPlacement::parse_cpu_list(const std::string& list, std::vector<int>& out) {
+    // "0-3,8,10-11"
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        try {
+            size_t dash = item.find('-');
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            if (first < 0 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            for (int cpu = first; cpu <= last; cpu++) {
+                out.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return !out.empty();
+}
+
+bool ThreadPlacement::parse(const std::string& spec, std::string& error) {
+    for (auto& role_cpus : cpus) {
+        role_cpus.clear();
+    }
+
+    std::stringstream stream(spec);
+    std::string entry;
+    while (std::getline(stream, entry, ';')) {
+        if (entry.empty()) {
+            continue;
+        }
+
+        size_t equals = entry.find('=');
+        std::string name = entry.substr(0, equals);
+        size_t role = 0;
+        while (role < static_cast<size_t>(ThreadRole::COUNT) && name != ROLE_NAMES[role]) {
+            role++;
+        }
+        if (equals == std::string::npos || role == static_cast<size_t>(ThreadRole::COUNT)) {
+            error = "Unknown thread role in '" + entry + "' (tun, socket, encrypt, decrypt, crypto, heartbeat)";
+            return false;
+        }
+        if (!parse_cpu_list(entry.substr(equals + 1), cpus[role])) {
+            error = "Invalid CPU list in '" + entry + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ThreadPlacement::empty() const {
+    for (const auto& role_cpus : cpus) {
+        if (!role_cpus.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ThreadPlacement::apply(ThreadRole role, size_t index, const std::string& name) const {
+    // The kernel takes at most 15 characters
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+    const std::vector<int>& role_cpus = cpus[static_cast<size_t>(role)];
+    if (role_cpus.empty()) {
+        return;
+    }
+
+    int cpu = role_cpus[index % role_cpus.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        Logger::log(LogLevel::WARNING, "Failed to pin " + name + " to CPU " + std::to_string(cpu) + ": " +
+                   NetworkUtils::get_error_string(result));
+    } else {
+        Logger::log(LogLevel::DEBUG, "Pinned " + name + " to CPU " + std::to_string(cpu));
+    }
+}
+
+int ThreadPlacement::numa_node() const {
+    int node = -1;
+    for (const auto& role_cpus : cpus) {
+        for (int cpu : role_cpus) {
+            int cpu_numa = cpu_node(cpu);
+            if (cpu_numa < 0 || (node >= 0 && cpu_numa != node)) {
+                return -1;
+            }
+            node = cpu_numa;
+        }
+    }
+    return node;
+}
+
+int ThreadPlacement::cpu_node(int cpu) {
+    // /sys/devices/system/cpu/cpuN holds a nodeM link
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return -1;
+    }
+
+    int node = -1;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(static_cast<unsigned char>(entry->d_name[4]))) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
@@ -0,0 +1,48 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include "utils.h"
+
+// Bridge thread roles that can be pinned
+enum class ThreadRole {
+    TUN_READER,     // "tun"
+    SOCKET_READER,  // "socket"
+    ENCRYPT,        // "encrypt": TUN -> socket pipelines
+    DECRYPT,        // "decrypt": socket -> TUN pipelines
+    CRYPTO,         // "crypto": crypto pool workers
+    HEARTBEAT,      // "heartbeat"
+    COUNT
+};
+
+// CPU placement per thread role, from a spec such as
+//   "tun=0-1;socket=2;encrypt=4,5;decrypt=6,7;crypto=8-15"
+// Threads of one role (one per TUN queue, or per crypto worker) take the
+// role's CPUs round robin, so listing as many CPUs as threads gives each its
+// own core. Roles left out are not pinned. Every thread is named either way.
+class ThreadPlacement {
+private:
+    std::vector<int> cpus[static_cast<size_t>(ThreadRole::COUNT)];
+
+    static bool parse_cpu_list(const std::string& list, std::vector<int>& out);
+
+public:
+    // Parse a placement spec; an empty spec pins nothing
+    bool parse(const std::string& spec, std::string& error);
+
+    bool is_pinned(ThreadRole role) const { return !cpus[static_cast<size_t>(role)].empty(); }
+    bool empty() const;
+
+    // Pin the calling thread as the index-th thread of its role and name it
+    // (names longer than 15 characters are cut)
+    void apply(ThreadRole role, size_t index, const std::string& name) const;
+
+    // NUMA node shared by all pinned CPUs; -1 if nothing is pinned or the CPUs span nodes
+    int numa_node() const;
+
+    // NUMA node of a CPU from sysfs, -1 if unknown
+    static int cpu_node(int cpu);
+
+    static const char* role_name(ThreadRole role);
+};
+
+#endif // THREAD_PLACEMENT_H
@@ -1,46 +1,101 @@
 #include "tun_manager.h"
 #include <cstdlib>
+#include <sys/uio.h>
 
-TunManager::TunManager() : tun_fd(-1), is_open(false) {
+TunManager::TunManager() : tun_fd(-1), queue_count(0), is_open(false), vnet_hdr(false) {
+    for (auto& fd : queue_fds) {
+        fd.store(-1, std::memory_order_relaxed);
+    }
 }
 
 TunManager::~TunManager() {
     close_tun();
 }
 
-bool TunManager::create_tun(const std::string& dev_name) {
+bool TunManager::create_tun(const std::string& dev_name, size_t num_queues, bool offload) {
     struct ifreq ifr;
-    int fd;
     
-    // Open TUN device
-    fd = open("/dev/net/tun", O_RDWR);
-    if (fd < 0) {
-        Logger::log(LogLevel::ERROR, "Failed to open /dev/net/tun: " + 
-                   NetworkUtils::get_error_string(errno));
-        return false;
+    if (num_queues == 0) {
+        num_queues = 1;
+    } else if (num_queues > MAX_TUN_QUEUES) {
+        Logger::log(LogLevel::WARNING, "Too many TUN queues requested, limiting to " + 
+                   std::to_string(MAX_TUN_QUEUES));
+        num_queues = MAX_TUN_QUEUES;
     }
     
     // Configure TUN interface
     memset(&ifr, 0, sizeof(ifr));
     ifr.ifr_flags = IFF_TUN | IFF_NO_PI;  // TUN device, no packet info
+    if (num_queues > 1) {
+        ifr.ifr_flags |= IFF_MULTI_QUEUE;  // Kernel spreads flows across queues
+    }
+    if (offload) {
+        ifr.ifr_flags |= IFF_VNET_HDR;  // virtio_net_hdr in front of every packet
+    }
     
     if (!dev_name.empty()) {
         strncpy(ifr.ifr_name, dev_name.c_str(), IFNAMSIZ - 1);
     }
     
-    // Create the interface
-    if (ioctl(fd, TUNSETIFF, (void*)&ifr) < 0) {
-        Logger::log(LogLevel::ERROR, "Failed to create TUN interface: " + 
-                   NetworkUtils::get_error_string(errno));
-        close(fd);
-        return false;
+    std::vector<int> fds;
+    for (size_t i = 0; i < num_queues; i++) {
+        // Open TUN device
+        int fd = open("/dev/net/tun", O_RDWR);
+        if (fd < 0) {
+            Logger::log(LogLevel::ERROR, "Failed to open /dev/net/tun: " + 
+                       NetworkUtils::get_error_string(errno));
+            for (int opened : fds) {
+                close(opened);
+            }
+            return false;
+        }
+        
+        // Create the interface (first queue) or attach another queue to it
+        if (ioctl(fd, TUNSETIFF, (void*)&ifr) < 0) {
+            Logger::log(LogLevel::ERROR, "Failed to create TUN interface: " + 
+                       NetworkUtils::get_error_string(errno));
+            close(fd);
+            for (int opened : fds) {
+                close(opened);
+            }
+            return false;
+        }
+        
+        // Offload mode: vnet header byte order and TSO/checksum offloads
+        if (offload && !configure_offload(fd, i == 0)) {
+            close(fd);
+            for (int opened : fds) {
+                close(opened);
+            }
+            return false;
+        }
+        
+        // Readers drain the queue until EAGAIN
+        if (!set_non_blocking(fd)) {
+            close(fd);
+            for (int opened : fds) {
+                close(opened);
+            }
+            return false;
+        }
+        
+        fds.push_back(fd);
     }
     
-    this->tun_fd = fd;
+    std::lock_guard<std::mutex> lock(tun_mutex);
     this->dev_name = std::string(ifr.ifr_name);
-    this->is_open = true;
-    
-    Logger::log(LogLevel::INFO, "TUN interface created: " + this->dev_name);
+    this->vnet_hdr = offload;
+    for (size_t i = 0; i < fds.size(); i++) {
+        queue_fds[i].store(fds[i], std::memory_order_relaxed);
+    }
+    // Release: a thread that sees the count sees the fds and settings above
+    this->queue_count.store(fds.size(), std::memory_order_release);
+    this->tun_fd.store(fds[0], std::memory_order_release);
+    this->is_open.store(true, std::memory_order_release);
+    
+    Logger::log(LogLevel::INFO, "TUN interface created: " + this->dev_name + 
+               (num_queues > 1 ? " with " + std::to_string(num_queues) + " queues" : "") +
+               (offload ? " (TSO/GSO offload)" : ""));
     return true;
 }
 
@@ -84,10 +139,9 @@ bool TunManager::configure_interface(const std::string& local_ip,
     return true;
 }
 
-ssize_t TunManager::read_packet(char* buffer, size_t buffer_size, int timeout_ms) {
-    std::lock_guard<std::mutex> lock(tun_mutex);
-    
-    if (!is_open || tun_fd < 0) {
+ssize_t TunManager::read_packet(char* buffer, size_t buffer_size, int timeout_ms, size_t queue) {
+    int fd = queue_fd(queue);
+    if (fd < 0) {
         return -1;
     }
     
@@ -97,18 +151,18 @@ ssize_t TunManager::read_packet(char* buffer, size_t buffer_size, int timeout_ms
         struct timeval timeout;
         
         FD_ZERO(&read_fds);
-        FD_SET(tun_fd, &read_fds);
+        FD_SET(fd, &read_fds);
         
         timeout.tv_sec = timeout_ms / 1000;
         timeout.tv_usec = (timeout_ms % 1000) * 1000;
         
-        int result = select(tun_fd + 1, &read_fds, nullptr, nullptr, &timeout);
+        int result = select(fd + 1, &read_fds, nullptr, nullptr, &timeout);
         if (result <= 0) {
             return result; // timeout or error
         }
     }
     
-    ssize_t bytes_read = read(tun_fd, buffer, buffer_size);
+    ssize_t bytes_read = read(fd, buffer, buffer_size);
     if (bytes_read < 0) {
         if (errno != EAGAIN && errno != EWOULDBLOCK) {
             Logger::log(LogLevel::ERROR, "Failed to read from TUN: " + 
@@ -117,19 +171,21 @@ ssize_t TunManager::read_packet(char* buffer, size_t buffer_size, int timeout_ms
         return -1;
     }
     
-    // Validate packet
-    if (bytes_read > 0 && !validate_packet(buffer, bytes_read)) {
+    // Validate packet (after the virtio_net_hdr in offload mode)
+    size_t hdr_size = get_vnet_hdr_size();
+    if (bytes_read > 0 && (static_cast<size_t>(bytes_read) <= hdr_size ||
+                           !validate_packet(buffer + hdr_size, bytes_read - hdr_size))) {
         Logger::log(LogLevel::WARNING, "Invalid packet received from TUN, dropping");
+        errno = EINVAL;
         return -1;
     }
     
     return bytes_read;
 }
 
-ssize_t TunManager::write_packet(const char* buffer, size_t packet_size) {
-    std::lock_guard<std::mutex> lock(tun_mutex);
-    
-    if (!is_open || tun_fd < 0) {
+ssize_t TunManager::write_packet(const char* buffer, size_t packet_size, size_t queue) {
+    int fd = queue_fd(queue);
+    if (fd < 0) {
         return -1;
     }
     
@@ -139,7 +195,20 @@ ssize_t TunManager::write_packet(const char* buffer, size_t packet_size) {
         return -1;
     }
     
-    ssize_t bytes_written = write(tun_fd, buffer, packet_size);
+    ssize_t bytes_written;
+    if (vnet_hdr) {
+        // Plain packet: empty header (no GSO, checksum already complete)
+        VnetHdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        struct iovec iov[2] = {
+            { &hdr, sizeof(hdr) },
+            { const_cast<char*>(buffer), packet_size }
+        };
+        bytes_written = writev(fd, iov, 2);
+    } else {
+        bytes_written = write(fd, buffer, packet_size);
+    }
+    
     if (bytes_written < 0) {
         Logger::log(LogLevel::ERROR, "Failed to write to TUN: " + 
                    NetworkUtils::get_error_string(errno));
@@ -149,13 +218,44 @@ ssize_t TunManager::write_packet(const char* buffer, size_t packet_size) {
     return bytes_written;
 }
 
+ssize_t TunManager::write_gso_packet(const VnetHdr& hdr, const char* buffer,
+                                     size_t packet_size, size_t queue) {
+    int fd = queue_fd(queue);
+    if (fd < 0 || !vnet_hdr) {
+        return -1;
+    }
+    
+    if (!validate_packet(buffer, packet_size)) {
+        Logger::log(LogLevel::WARNING, "Invalid packet format, refusing to write to TUN");
+        return -1;
+    }
+    
+    // The kernel checks the header against the packet (EINVAL on mismatch)
+    struct iovec iov[2] = {
+        { const_cast<VnetHdr*>(&hdr), sizeof(hdr) },
+        { const_cast<char*>(buffer), packet_size }
+    };
+    ssize_t bytes_written = writev(fd, iov, 2);
+    if (bytes_written < 0) {
+        Logger::log(LogLevel::ERROR, "Failed to write GSO packet to TUN: " + 
+                   NetworkUtils::get_error_string(errno));
+        return -1;
+    }
+    
+    return bytes_written;
+}
+
 void TunManager::close_tun() {
     std::lock_guard<std::mutex> lock(tun_mutex);
     
     if (is_open && tun_fd >= 0) {
-        close(tun_fd);
-        tun_fd = -1;
-        is_open = false;
+        // Unpublish first so new packet calls fail instead of using a closed fd
+        size_t count = queue_count.exchange(0, std::memory_order_acq_rel);
+        tun_fd.store(-1, std::memory_order_release);
+        is_open.store(false, std::memory_order_release);
+        for (size_t i = 0; i < count; i++) {
+            close(queue_fds[i].exchange(-1, std::memory_order_relaxed));
+        }
         
         Logger::log(LogLevel::INFO, "TUN interface closed: " + dev_name);
         
@@ -186,8 +286,8 @@ bool TunManager::validate_packet(const char* buffer, size_t size) const {
         return false;
     }
     
-    // Check packet size limits
-    if (size > MTU_SIZE) {
+    // Check packet size limits (GSO super-packets in offload mode)
+    if (size > (vnet_hdr ? GSO_MAX_PACKET_SIZE : MTU_SIZE)) {
         Logger::log(LogLevel::WARNING, "Packet size exceeds MTU: " + std::to_string(size));
         return false;
     }
@@ -195,6 +295,27 @@ bool TunManager::validate_packet(const char* buffer, size_t size) const {
     return true;
 }
 
+bool TunManager::configure_offload(int fd, bool first_queue) {
+    int little_endian = 1;
+    if (ioctl(fd, TUNSETVNETLE, &little_endian) < 0) {
+        Logger::log(LogLevel::ERROR, "Failed to set little-endian vnet headers: " + 
+                   NetworkUtils::get_error_string(errno));
+        return false;
+    }
+    
+    // Offloads are a device property; set them once
+    if (first_queue) {
+        unsigned int offloads = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6;
+        if (ioctl(fd, TUNSETOFFLOAD, offloads) < 0) {
+            Logger::log(LogLevel::ERROR, "Failed to enable TUN offloads: " + 
+                       NetworkUtils::get_error_string(errno));
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 bool TunManager::set_non_blocking(int fd) {
     int flags = fcntl(fd, F_GETFL, 0);
     if (flags < 0) {
@@ -3,15 +3,34 @@
 
 #include "utils.h"
 #include "command_executor.h"
+#include "gso_segmenter.h"
 
+// Upper bound on IFF_MULTI_QUEUE queues accepted by the kernel
+#define MAX_TUN_QUEUES 256
+
+// The packet path (read/write, fd and state getters) takes no lock: the fds
+// and state are atomics published by create_tun, and reads and writes on a
+// TUN fd are safe from any number of threads. tun_mutex only serializes
+// create_tun and close_tun; close the device after the threads using it stop.
 class TunManager {
 private:
-    int tun_fd;
+    std::atomic<int> tun_fd;                       // First queue (single-queue mode uses only this)
+    std::atomic<int> queue_fds[MAX_TUN_QUEUES];    // One fd per IFF_MULTI_QUEUE queue, -1 when closed
+    std::atomic<size_t> queue_count;               // Open queues; published after the fds
     std::string dev_name;
     std::string local_ip;
     std::string netmask;
-    bool is_open;
-    mutable std::mutex tun_mutex;  // Thread safety
+    std::atomic<bool> is_open;
+    bool vnet_hdr;               // Offload mode: packets carry a virtio_net_hdr
+    std::mutex tun_mutex;        // Serializes open and close
+    
+    // fd of a queue, -1 if it is not open
+    int queue_fd(size_t queue) const {
+        if (queue >= queue_count.load(std::memory_order_acquire)) {
+            return -1;
+        }
+        return queue_fds[queue].load(std::memory_order_relaxed);
+    }
 
 public:
     TunManager();
@@ -21,8 +40,9 @@ public:
     TunManager(const TunManager&) = delete;
     TunManager& operator=(const TunManager&) = delete;
     
-    // Create TUN interface
-    bool create_tun(const std::string& dev_name);
+    // Create TUN interface (num_queues > 1 enables IFF_MULTI_QUEUE,
+    // offload enables IFF_VNET_HDR with TSO4/TSO6/CSUM)
+    bool create_tun(const std::string& dev_name, size_t num_queues = 1, bool offload = false);
     
     // Configure TUN interface with IP
     bool configure_interface(const std::string& local_ip,
@@ -30,29 +50,36 @@ public:
                             const std::string& netmask = "255.255.255.0",
                             int mtu = 1408);
     
-    // Read packet from TUN interface with timeout
-    ssize_t read_packet(char* buffer, size_t buffer_size, int timeout_ms = -1);
+    // Read packet from a TUN queue with timeout
+    // (in offload mode the buffer starts with a virtio_net_hdr)
+    ssize_t read_packet(char* buffer, size_t buffer_size, int timeout_ms = -1, size_t queue = 0);
     
-    // Write packet to TUN interface (thread-safe)
-    ssize_t write_packet(const char* buffer, size_t packet_size);
+    // Write a plain IP packet to a TUN queue (thread-safe)
+    ssize_t write_packet(const char* buffer, size_t packet_size, size_t queue = 0);
+    
+    // Write a packet described by a virtio_net_hdr (offload mode only)
+    ssize_t write_gso_packet(const VnetHdr& hdr, const char* buffer,
+                             size_t packet_size, size_t queue = 0);
+    
+    // Offload mode details
+    bool has_vnet_hdr() const { return vnet_hdr; }
+    size_t get_vnet_hdr_size() const { return vnet_hdr ? VNET_HDR_SIZE : 0; }
+    size_t get_read_size() const { return vnet_hdr ? TUN_OFFLOAD_READ_SIZE : BUFFER_SIZE; }
     
     // Get TUN file descriptor (thread-safe)
-    int get_fd() const { 
-        std::lock_guard<std::mutex> lock(tun_mutex);
-        return tun_fd; 
-    }
+    int get_fd() const { return tun_fd.load(std::memory_order_acquire); }
     
-    // Get device name (thread-safe)
-    const std::string& get_device_name() const { 
-        std::lock_guard<std::mutex> lock(tun_mutex);
-        return dev_name; 
-    }
+    // Get file descriptor of a specific queue (thread-safe)
+    int get_queue_fd(size_t queue) const { return queue_fd(queue); }
+    
+    // Number of open queues (thread-safe)
+    size_t get_queue_count() const { return queue_count.load(std::memory_order_acquire); }
+    
+    // Get device name (set once by create_tun)
+    const std::string& get_device_name() const { return dev_name; }
     
     // Check if TUN is open (thread-safe)
-    bool is_opened() const { 
-        std::lock_guard<std::mutex> lock(tun_mutex);
-        return is_open; 
-    }
+    bool is_opened() const { return is_open.load(std::memory_order_acquire); }
     
     // Close TUN interface (thread-safe)
     void close_tun();
@@ -66,6 +93,9 @@ private:
     
     // Set file descriptor to non-blocking mode
     bool set_non_blocking(int fd);
+    
+    // Enable little-endian vnet headers and TSO/checksum offload on a queue
+    bool configure_offload(int fd, bool first_queue);
 };
 
 #endif // TUN_MANAGER_H
@@ -0,0 +1,74 @@
+#include "tx_batcher.h"
+#include <algorithm>
+
+TxBatcher::TxBatcher(const TxFlushPolicy& policy) : policy(policy), bytes(0), in_flight_frames(0) {
+    frames.reserve(policy.max_frames);
+    iovs.reserve(policy.max_frames);
+}
+
+void TxBatcher::reclaim(SocketManager* socket) {
+    while (!in_flight.empty() && socket->zerocopy_complete(in_flight.front().id)) {
+        in_flight_frames -= in_flight.front().frames.size();
+        in_flight.pop_front();
+    }
+}
+
+void TxBatcher::add(PacketPtr&& frame) {
+    if (frames.empty()) {
+        first_frame = std::chrono::steady_clock::now();
+    }
+    bytes += frame->size();
+    frames.push_back(std::move(frame));
+}
+
+std::chrono::microseconds TxBatcher::time_left() const {
+    if (frames.empty() || policy.flush_usec == 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    auto due = first_frame + std::chrono::microseconds(policy.flush_usec);
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(due - std::chrono::steady_clock::now());
+    return std::max(left, std::chrono::microseconds(0));
+}
+
+ssize_t TxBatcher::flush(SocketManager* socket) {
+    if (frames.empty()) {
+        return 0;
+    }
+
+    iovs.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        iovs[i].iov_base = frames[i]->data();
+        iovs[i].iov_len = frames[i]->size();
+    }
+
+    // Zero-copy only pays off for large sends, and needs the buffers to outlive the call
+    if (!in_flight.empty()) {
+        reclaim(socket);
+    }
+    bool zerocopy = policy.zerocopy_bytes > 0 && bytes >= policy.zerocopy_bytes &&
+                    socket->is_zerocopy_enabled() && in_flight.size() < TX_MAX_ZEROCOPY_BATCHES &&
+                    in_flight_frames + frames.size() <= TX_MAX_ZEROCOPY_FRAMES;
+
+    ssize_t result;
+    if (zerocopy) {
+        // Held only under an id the kernel assigned; otherwise the pages were copied
+        ZerocopyBatch batch;
+        bool pinned;
+        result = socket->send_frames_zerocopy(iovs.data(), iovs.size(), batch.id, pinned);
+        if (pinned) {
+            in_flight_frames += frames.size();
+            batch.frames.swap(frames);
+            frames.reserve(policy.max_frames);
+            in_flight.push_back(std::move(batch));
+        } else {
+            frames.clear();
+        }
+    } else {
+        result = socket->send_frames(iovs.data(), iovs.size());
+        frames.clear();
+    }
+
+    bytes = 0;
+    return result;
+}
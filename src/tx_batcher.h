@@ -0,0 +1,75 @@
+#ifndef TX_BATCHER_H
+#define TX_BATCHER_H
+
+#include "utils.h"
+#include "socket_manager.h"
+#include "packet_pool.h"
+#include <sys/uio.h>
+#include <climits>
+#include <deque>
+
+// Default transmit flush policy
+#define TX_BATCH_FRAMES 64              // Frames per sendmsg
+#define TX_BATCH_BYTES (256 * 1024)     // Bytes per sendmsg
+#define TX_FLUSH_USEC 0                 // Extra wait for more frames once the queue is drained
+#define TX_MAX_BATCH_FRAMES IOV_MAX     // Upper bound for the frame limit
+#define TX_MAX_ZEROCOPY_BATCHES 64      // Batches awaiting completion before sends copy again ...
+#define TX_MAX_ZEROCOPY_FRAMES (PACKET_LARGE_MAX / 8)  // ... or buffers, so pipelines cannot pin a pool class
+#define TX_RECLAIM_USEC 1000            // Idle pipelines check for completed zero-copy sends this often
+
+// When staged frames go out: whichever limit is hit first
+struct TxFlushPolicy {
+    size_t max_frames;
+    size_t max_bytes;
+    unsigned flush_usec;  // 0: flush as soon as the encrypt thread runs out of packets
+    size_t zerocopy_bytes;  // Batches at least this large use MSG_ZEROCOPY (0: never)
+
+    TxFlushPolicy() : max_frames(TX_BATCH_FRAMES), max_bytes(TX_BATCH_BYTES), flush_usec(TX_FLUSH_USEC),
+                      zerocopy_bytes(ZEROCOPY_THRESHOLD) {}
+};
+
+// Collects the wrapped frames of one drain cycle and sends them with a single
+// sendmsg over an iovec array. Frames are pooled packet
+// buffers; a batch sent with MSG_ZEROCOPY goes back to the pool only once the
+// kernel reports the send complete.
+// Not thread-safe: each encrypt thread owns its batcher.
+class TxBatcher {
+private:
+    struct ZerocopyBatch {
+        uint32_t id;
+        std::vector<PacketPtr> frames;
+    };
+
+    TxFlushPolicy policy;
+    std::vector<PacketPtr> frames;
+    std::vector<struct iovec> iovs;
+    size_t bytes;
+    std::chrono::steady_clock::time_point first_frame;
+    std::deque<ZerocopyBatch> in_flight;
+    size_t in_flight_frames;
+
+public:
+    explicit TxBatcher(const TxFlushPolicy& policy = TxFlushPolicy());
+
+    // Stage a frame (takes ownership of the buffer)
+    void add(PacketPtr&& frame);
+
+    bool empty() const { return frames.empty(); }
+    size_t size() const { return frames.size(); }
+
+    // Frame or byte limit reached
+    bool full() const { return frames.size() >= policy.max_frames || bytes >= policy.max_bytes; }
+
+    // Time until the oldest staged frame is due (zero when overdue)
+    std::chrono::microseconds time_left() const;
+
+    // Send everything staged; returns the number of frames sent or -1
+    ssize_t flush(SocketManager* socket);
+
+    // Release the zero-copy batches the kernel is done with. flush() does so
+    // too; without traffic, call it every TX_RECLAIM_USEC while pending.
+    void reclaim(SocketManager* socket);
+    bool zerocopy_pending() const { return !in_flight.empty(); }
+};
+
+#endif // TX_BATCHER_H
@@ -0,0 +1,266 @@
+#include "uring_engine.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <algorithm>
+
+#ifdef LINKNET_HAVE_IO_URING
+
+// user_data of the engine's own cancel requests
+static const uint64_t URING_TAG_CANCEL = ~0ULL - 2;
+
+static int io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+UringEngine::UringEngine()
+    : ring_fd(-1), pending(0), in_flight(0),
+      sq_head(nullptr), sq_tail(nullptr), sq_ring_mask(nullptr), sq_array(nullptr), sqes(nullptr),
+      cq_head(nullptr), cq_tail(nullptr), cq_ring_mask(nullptr), cqes(nullptr),
+      sq_ring_ptr(nullptr), sq_ring_size(0), cq_ring_ptr(nullptr), cq_ring_size(0), sqes_size(0) {
+}
+
+UringEngine::~UringEngine() {
+    if (sqes) {
+        munmap(sqes, sqes_size);
+    }
+    if (cq_ring_ptr && cq_ring_ptr != sq_ring_ptr) {
+        munmap(cq_ring_ptr, cq_ring_size);
+    }
+    if (sq_ring_ptr) {
+        munmap(sq_ring_ptr, sq_ring_size);
+    }
+    if (ring_fd >= 0) {
+        close(ring_fd);
+    }
+}
+
+bool UringEngine::is_supported() {
+    static int supported = -1;
+    if (supported < 0) {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = io_uring_setup(2, &params);
+        supported = fd >= 0 ? 1 : 0;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    return supported == 1;
+}
+
+bool UringEngine::setup(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        Logger::log(LogLevel::ERROR, "io_uring_setup failed: " + NetworkUtils::get_error_string(errno));
+        return false;
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // Newer kernels map both rings with a single mmap
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring_ptr = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr == MAP_FAILED) {
+        sq_ring_ptr = nullptr;
+        Logger::log(LogLevel::ERROR, "Failed to map io_uring SQ ring: " + NetworkUtils::get_error_string(errno));
+        return false;
+    }
+
+    if (single_mmap) {
+        cq_ring_ptr = sq_ring_ptr;
+    } else {
+        cq_ring_ptr = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ptr == MAP_FAILED) {
+            cq_ring_ptr = nullptr;
+            Logger::log(LogLevel::ERROR, "Failed to map io_uring CQ ring: " + NetworkUtils::get_error_string(errno));
+            return false;
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes_ptr == MAP_FAILED) {
+        Logger::log(LogLevel::ERROR, "Failed to map io_uring SQEs: " + NetworkUtils::get_error_string(errno));
+        return false;
+    }
+    sqes = static_cast<struct io_uring_sqe*>(sqes_ptr);
+
+    char* sq = static_cast<char*>(sq_ring_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_ring_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_ring_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_ring_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    Logger::log(LogLevel::DEBUG, "io_uring ready with " + std::to_string(params.sq_entries) + " entries");
+    return true;
+}
+
+bool UringEngine::register_buffers(const struct iovec* buffers, unsigned count) {
+    if (io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, buffers, count) < 0) {
+        Logger::log(LogLevel::WARNING, "Failed to register io_uring buffers: " +
+                   NetworkUtils::get_error_string(errno));
+        return false;
+    }
+    return true;
+}
+
+struct io_uring_sqe* UringEngine::get_sqe() {
+    // Entries are filled first and published to the kernel in submit_and_wait()
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail + pending;
+    if (tail - head > *sq_ring_mask) {
+        return nullptr; // SQ full
+    }
+
+    unsigned index = tail & *sq_ring_mask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+
+    pending++;
+    return sqe;
+}
+
+bool UringEngine::prep_read_fixed(int fd, void* buffer, unsigned length, int buffer_index, uint64_t user_data) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = length;
+    sqe->buf_index = buffer_index;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool UringEngine::prep_read(int fd, void* buffer, unsigned length, uint64_t user_data) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = length;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool UringEngine::prep_write(int fd, const void* buffer, unsigned length, uint64_t user_data) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = length;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool UringEngine::prep_poll_add(int fd, unsigned poll_mask, uint64_t user_data, bool link) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = poll_mask;
+    sqe->user_data = user_data;
+    if (link) {
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+    return true;
+}
+
+int UringEngine::submit_and_wait(unsigned wait_nr) {
+    unsigned tail = *sq_tail + pending;
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+    pending = 0;
+
+    // Includes entries left over from an earlier partial submit
+    unsigned to_submit = tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    int submitted = io_uring_enter(ring_fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0);
+    if (submitted > 0) {
+        in_flight += submitted;
+    }
+    return submitted;
+}
+
+bool UringEngine::cancel_and_drain(const uint64_t* user_data, unsigned count) {
+    while (in_flight > 0 || pending > 0) {
+        // Cancel again every round: one cancel stops only the first match
+        for (unsigned i = 0; i < count; i++) {
+            struct io_uring_sqe* sqe = get_sqe();
+            if (!sqe) {
+                break;
+            }
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = user_data[i];
+            sqe->user_data = URING_TAG_CANCEL;
+        }
+        if (submit_and_wait(1) < 0 && errno != EINTR) {
+            Logger::log(LogLevel::ERROR, "io_uring cancel failed: " + NetworkUtils::get_error_string(errno));
+            return false;
+        }
+        reap([](uint64_t, int) {});
+    }
+    return true;
+}
+
+#else // !LINKNET_HAVE_IO_URING
+
+UringEngine::UringEngine() : ring_fd(-1), pending(0), in_flight(0) {
+}
+
+UringEngine::~UringEngine() {
+}
+
+bool UringEngine::is_supported() {
+    return false;
+}
+
+bool UringEngine::setup(unsigned) {
+    Logger::log(LogLevel::ERROR, "io_uring support not compiled in");
+    return false;
+}
+
+bool UringEngine::register_buffers(const struct iovec*, unsigned) { return false; }
+bool UringEngine::prep_read_fixed(int, void*, unsigned, int, uint64_t) { return false; }
+bool UringEngine::prep_read(int, void*, unsigned, uint64_t) { return false; }
+bool UringEngine::prep_write(int, const void*, unsigned, uint64_t) { return false; }
+bool UringEngine::prep_poll_add(int, unsigned, uint64_t, bool) { return false; }
+int UringEngine::submit_and_wait(unsigned) { errno = ENOSYS; return -1; }
+bool UringEngine::cancel_and_drain(const uint64_t*, unsigned) { return true; }
+
+#endif // LINKNET_HAVE_IO_URING
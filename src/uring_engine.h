@@ -0,0 +1,115 @@
+#ifndef URING_ENGINE_H
+#define URING_ENGINE_H
+
+#include "utils.h"
+#include <sys/uio.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define LINKNET_HAVE_IO_URING 1
+#endif
+#endif
+
+// io_uring settings
+#define URING_QUEUE_DEPTH 256    // Submission queue entries per ring
+#define URING_TUN_READS 32       // TUN reads kept in flight per queue
+#define URING_BATCH_SIZE 64      // Packets handled per pipeline flush
+
+// I/O engine used by the Bridge data path
+enum class IoEngine {
+    EPOLL,    // Edge-triggered epoll reactor (default)
+    IO_URING  // io_uring with fixed buffers and batched submission
+};
+
+// Minimal io_uring ring built on the raw syscalls (no liburing dependency).
+// A ring is owned by exactly one thread; nothing here is thread-safe.
+class UringEngine {
+private:
+    int ring_fd;
+    unsigned pending;    // SQEs filled but not yet published to the kernel
+    unsigned in_flight;  // Submitted requests whose completion is not reaped yet
+
+#ifdef LINKNET_HAVE_IO_URING
+    // Submission queue
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_ring_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+
+    // Completion queue
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_ring_mask;
+    struct io_uring_cqe* cqes;
+
+    // Mappings
+    void* sq_ring_ptr;
+    size_t sq_ring_size;
+    void* cq_ring_ptr;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    struct io_uring_sqe* get_sqe();
+#endif
+
+public:
+    UringEngine();
+    ~UringEngine();
+
+    // Disable copy constructor and assignment operator
+    UringEngine(const UringEngine&) = delete;
+    UringEngine& operator=(const UringEngine&) = delete;
+
+    // Check once whether the running kernel allows io_uring
+    static bool is_supported();
+
+    // Create the ring
+    bool setup(unsigned entries = URING_QUEUE_DEPTH);
+    bool is_valid() const { return ring_fd >= 0; }
+
+    // Register fixed buffers for READ_FIXED / WRITE_FIXED
+    bool register_buffers(const struct iovec* buffers, unsigned count);
+
+    // Queue operations (return false when the SQ is full)
+    bool prep_read_fixed(int fd, void* buffer, unsigned length, int buffer_index, uint64_t user_data);
+    bool prep_read(int fd, void* buffer, unsigned length, uint64_t user_data);
+    bool prep_write(int fd, const void* buffer, unsigned length, uint64_t user_data);
+    bool prep_poll_add(int fd, unsigned poll_mask, uint64_t user_data, bool link = false);
+
+    // Submit queued SQEs and wait for at least wait_nr completions (one syscall)
+    int submit_and_wait(unsigned wait_nr);
+
+    // Cancel the requests tagged with any of user_data and wait until nothing
+    // is in flight, so the buffers they point at can be released. Closing the
+    // ring alone does not wait for the kernel to let go of them.
+    bool cancel_and_drain(const uint64_t* user_data, unsigned count);
+
+    // Process all available completions: handler(user_data, result) where
+    // result is bytes transferred or -errno. Returns the number handled.
+    template <typename Handler>
+    unsigned reap(Handler&& handler) {
+        unsigned count = 0;
+#ifdef LINKNET_HAVE_IO_URING
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const struct io_uring_cqe* cqe = &cqes[head & *cq_ring_mask];
+            uint64_t user_data = cqe->user_data;
+            int result = cqe->res;
+            head++;
+            count++;
+            in_flight--;
+            // Release the slot before the handler queues follow-up work
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            handler(user_data, result);
+        }
+#else
+        (void)handler;
+#endif
+        return count;
+    }
+};
+
+#endif // URING_ENGINE_H
@@ -24,7 +24,8 @@
 
 // Buffer size for packet processing
 #define BUFFER_SIZE 4096
-#define MTU_SIZE 1408        // TUN MTU: 1500 - VPN overhead (56 + 20 + 16) = 1408
+#define MTU_SIZE 1408        // TUN MTU: 1408 + 36-byte header + IP/TCP headers fit in 1500
+#define CRYPTO_MAX_WORKERS 64  // Crypto threads per pipeline pool
 
 // Log levels
 enum class LogLevel {
@@ -177,8 +178,26 @@ struct Config {
     bool enable_keepalive;      // TCP keepalive
     int reconnect_interval;     // Reconnection interval in seconds
     
+    // Performance settings
+    std::string transport;      // Tunnel transport: "tcp" or "udp"
+    int tun_queues;             // TUN queues (IFF_MULTI_QUEUE when > 1)
+    std::string io_engine;      // Data path I/O engine: "epoll" or "uring"
+    bool tun_offload;           // IFF_VNET_HDR with TSO/GSO super-packets
+    int tx_batch_frames;        // Socket transmit flush: frames per batch
+    int tx_batch_bytes;         // Socket transmit flush: bytes per batch
+    int tx_flush_usec;          // Socket transmit flush: wait for more frames (0 = none)
+    int zerocopy_threshold;     // MSG_ZEROCOPY for sends of at least this many bytes (0 = off)
+    int crypto_workers;         // Crypto threads per pipeline (0 = crypto on the pipeline thread)
+    std::string flow_steering;  // Encrypt worker choice: "none" (round robin), "toeplitz", "symmetric"
+    std::string cpu_affinity;   // Thread pinning per role, e.g. "tun=0;encrypt=1;decrypt=2" (empty = none)
+    bool latency_mode;          // Busy-poll the data path instead of sleeping right away
+    int spin_budget_usec;       // Latency mode: busy-poll this long before blocking
+    
     // Encryption settings
     bool enable_encryption;     // Enable encryption
+    std::string cipher;         // Data cipher: "auto" (benchmark), "aes-256-gcm", "chacha20-poly1305"
+    int rekey_interval;         // New send key after this many seconds (0 = never)
+    long long rekey_packets;    // ... or after this many packets under one key (0 = never)
     std::string psk;           // Pre-shared key
     std::string psk_file;      // PSK file path
     
@@ -187,8 +206,11 @@ struct Config {
     std::string default_route_interface;      // Save original default route interface
     
     Config() : port(51860), netmask("255.255.255.0"), tun_mtu(1408),
-               enable_keepalive(true), reconnect_interval(5),
-               enable_encryption(true), enable_auto_route(false) {}
+               enable_keepalive(true), reconnect_interval(5), transport("tcp"), tun_queues(1), io_engine("epoll"),
+               tun_offload(false), tx_batch_frames(64), tx_batch_bytes(256 * 1024), tx_flush_usec(0),
+               zerocopy_threshold(32 * 1024), crypto_workers(0), flow_steering("none"),
+               latency_mode(false), spin_budget_usec(50), enable_encryption(true), cipher("auto"),
+               rekey_interval(3600), rekey_packets(1LL << 32), enable_auto_route(false) {}
                
     // Validate configuration
     std::vector<std::string> validate() const {
@@ -230,6 +252,54 @@ struct Config {
             errors.push_back("Device name too long (max 15 characters)");
         }
         
+        if (transport != "tcp" && transport != "udp") {
+            errors.push_back("Transport must be 'tcp' or 'udp'");
+        }
+        
+        if (tun_queues < 1 || tun_queues > 256) {
+            errors.push_back("TUN queues must be between 1 and 256");
+        }
+        
+        if (tx_batch_frames < 1 || tx_batch_frames > 1024) {
+            errors.push_back("TX batch must be between 1 and 1024 frames");
+        }
+        
+        if (tx_batch_bytes < 1) {
+            errors.push_back("TX batch byte limit must be positive");
+        }
+        
+        if (tx_flush_usec < 0 || tx_flush_usec > 10000) {
+            errors.push_back("TX flush deadline must be between 0 and 10000 microseconds");
+        }
+        
+        if (zerocopy_threshold < 0) {
+            errors.push_back("Zero-copy threshold must not be negative");
+        }
+        
+        if (crypto_workers < 0 || crypto_workers > CRYPTO_MAX_WORKERS) {
+            errors.push_back("Crypto workers must be between 0 and " + std::to_string(CRYPTO_MAX_WORKERS));
+        }
+        
+        if (flow_steering != "none" && flow_steering != "toeplitz" && flow_steering != "symmetric") {
+            errors.push_back("Flow steering must be 'none', 'toeplitz' or 'symmetric'");
+        }
+        
+        if (spin_budget_usec < 0 || spin_budget_usec > 100000) {
+            errors.push_back("Spin budget must be between 0 and 100000 microseconds");
+        }
+        
+        if (cipher != "auto" && cipher != "aes-256-gcm" && cipher != "chacha20-poly1305") {
+            errors.push_back("Cipher must be 'auto', 'aes-256-gcm' or 'chacha20-poly1305'");
+        }
+        
+        if (io_engine != "epoll" && io_engine != "uring") {
+            errors.push_back("I/O engine must be 'epoll' or 'uring'");
+        }
+        
+        if (rekey_interval < 0 || rekey_packets < 0) {
+            errors.push_back("Rekey interval and packet limit must not be negative");
+        }
+        
         if (tun_mtu < 576 || tun_mtu > 1408) {
             errors.push_back("TUN MTU must be between 576 and 1408 bytes");
         }